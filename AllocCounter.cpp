@@ -0,0 +1,68 @@
+#include "MemoryUsage.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// 进程级分配计数，只给基准测试用：CONFIG += alloc_count 时由 core.pri 编进可执行文件，
+// 静态初始化时向 MemoryUsage 登记。glibc 下直接接管 malloc 家族，Qt 容器（走 malloc）和
+// operator new 都能数到；其它平台（MSVC）只数 operator new，Qt 容器的分配数不到
+namespace {
+std::atomic<quint64> g_allocs{0};
+
+qint64 allocationCount()
+{
+    return qint64(g_allocs.load(std::memory_order_relaxed));
+}
+
+const bool g_registered = (MemoryUsage::setAllocationCounter(&allocationCount), true);
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+
+void* malloc(size_t size)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t size)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+void free(void* p)
+{
+    __libc_free(p);
+}
+}
+#else
+void* operator new(std::size_t size)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
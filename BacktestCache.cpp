@@ -0,0 +1,204 @@
+#include "BacktestCache.h"
+#include "MemoryUsage.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+// 每只股票磁盘上最多保留的结果条数，超出时丢掉任意旧条目
+constexpr int kMaxRunsPerFile = 64;
+
+static QJsonObject toJson(const SymbolBacktest& r)
+{
+    QJsonArray trades;
+    for (const auto& t : r.trades) {
+        trades.append(QJsonArray{t.buyIndex, t.sellIndex, t.entry, t.exit, t.returnPct});
+    }
+    QJsonArray equity;
+    for (double v : r.equity) equity.append(v);
+
+    QJsonObject o;
+    o.insert("start", r.startIndex);
+    o.insert("end", r.endIndex);
+    o.insert("trades", trades);
+    o.insert("equity", equity);
+    o.insert("ret", r.totalReturnPct);
+    o.insert("mdd", r.maxDrawdownPct);
+    o.insert("n", r.tradeCount);
+    o.insert("wins", r.wins);
+    o.insert("sum", r.tradeReturnSumPct);
+    return o;
+}
+
+static SymbolBacktest fromJson(const QString& code, const QJsonObject& o)
+{
+    SymbolBacktest r;
+    r.code = code;
+    r.ok = true;
+    r.startIndex = o.value("start").toInt(-1);
+    r.endIndex = o.value("end").toInt(-1);
+    for (const auto& v : o.value("trades").toArray()) {
+        const auto a = v.toArray();
+        if (a.size() < 5) continue;
+        BacktestTrade t;
+        t.buyIndex = a[0].toInt();
+        t.sellIndex = a[1].toInt();
+        t.entry = a[2].toDouble();
+        t.exit = a[3].toDouble();
+        t.returnPct = a[4].toDouble();
+        r.trades.push_back(t);
+    }
+    const auto equity = o.value("equity").toArray();
+    r.equity.reserve(equity.size());
+    for (const auto& v : equity) r.equity.push_back(v.toDouble());
+    r.totalReturnPct = o.value("ret").toDouble();
+    r.maxDrawdownPct = o.value("mdd").toDouble();
+    r.tradeCount = o.value("n").toInt();
+    r.wins = o.value("wins").toInt();
+    r.tradeReturnSumPct = o.value("sum").toDouble();
+    return r;
+}
+
+// 大致按占用的 double 个数计成本
+constexpr qint64 kBytesPerCost = 8;
+
+static int costOf(const SymbolBacktest& r)
+{
+    return 16 + r.equity.size() + r.trades.size() * 5;
+}
+}
+
+BacktestCache& BacktestCache::instance()
+{
+    static BacktestCache cache;
+    return cache;
+}
+
+BacktestCache::BacktestCache()
+{
+    setMemoryLimit(MemoryUsage::limits().backtestCacheBytes);
+}
+
+void BacktestCache::setMemoryLimit(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    // Qt5 的 QCache 成本是 int：不限或超出时取 int 上限
+    const qint64 cost = bytes > 0 ? bytes / kBytesPerCost : std::numeric_limits<int>::max();
+    m_memory.setMaxCost(int(std::min<qint64>(cost, std::numeric_limits<int>::max())));
+}
+
+qint64 BacktestCache::memoryBytes()
+{
+    QMutexLocker locker(&m_mutex);
+    return qint64(m_memory.totalCost()) * kBytesPerCost;
+}
+
+QString BacktestCache::key(const QString& code, const QDate& startDate, const QDate& endDate,
+                           const BacktestParams& params, quint64 barsVersion)
+{
+    return QString("%1|%2|%3|%4|%5|%6|%7")
+        .arg(code)
+        .arg(startDate.toString("yyyyMMdd"))
+        .arg(endDate.toString("yyyyMMdd"))
+        .arg(params.buyBelowDays)
+        .arg(params.sellBelowDays)
+        .arg(QString::number(params.buyMaxRisePct, 'f', 4))
+        .arg(barsVersion);
+}
+
+QString BacktestCache::filePath(const QString& code) const
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/backtests";
+    QDir().mkpath(dir);
+    return dir + "/" + code + ".json";
+}
+
+void BacktestCache::loadFromDisk(const QString& code, quint64 barsVersion)
+{
+    m_diskLoaded.insert(code, barsVersion);
+
+    QFile f(filePath(code));
+    if (!f.open(QIODevice::ReadOnly)) return;
+    const auto root = QJsonDocument::fromJson(f.readAll()).object();
+    if (root.value("v").toVariant().toULongLong() != barsVersion) return;
+
+    const auto runs = root.value("runs").toObject();
+    for (auto it = runs.constBegin(); it != runs.constEnd(); ++it) {
+        auto* r = new SymbolBacktest(fromJson(code, it.value().toObject()));
+        m_memory.insert(it.key(), r, costOf(*r));
+    }
+}
+
+bool BacktestCache::lookup(const QString& code, quint64 barsVersion, const QString& key, SymbolBacktest* out)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_memory.contains(key) && m_diskLoaded.value(code, quint64(-1)) != barsVersion) {
+        loadFromDisk(code, barsVersion);
+    }
+    const SymbolBacktest* r = m_memory.object(key);
+    if (!r) return false;
+    if (out) *out = *r;
+    return true;
+}
+
+void BacktestCache::insert(const QString& code, quint64 barsVersion, const QString& key,
+                           const SymbolBacktest& result)
+{
+    if (!result.ok) return;
+    QMutexLocker locker(&m_mutex);
+    m_memory.insert(key, new SymbolBacktest(result), costOf(result));
+
+    DirtyRuns& dirty = m_dirty[code];
+    if (dirty.barsVersion != barsVersion) {     // K线更新过：旧版本的待写结果作废
+        dirty.barsVersion = barsVersion;
+        dirty.runs.clear();
+    }
+    dirty.runs.insert(key, result);
+}
+
+void BacktestCache::flush()
+{
+    QHash<QString, DirtyRuns> dirty;
+    {
+        QMutexLocker locker(&m_mutex);
+        dirty.swap(m_dirty);
+    }
+
+    for (auto it = dirty.cbegin(); it != dirty.cend(); ++it) {
+        const QString& code = it.key();
+        const quint64 barsVersion = it->barsVersion;
+
+        // 读-改-写该股票的文件；版本不同的旧结果整体丢弃
+        QJsonObject runs;
+        {
+            QFile f(filePath(code));
+            if (f.open(QIODevice::ReadOnly)) {
+                const auto root = QJsonDocument::fromJson(f.readAll()).object();
+                if (root.value("v").toVariant().toULongLong() == barsVersion) runs = root.value("runs").toObject();
+            }
+        }
+        for (auto r = it->runs.cbegin(); r != it->runs.cend(); ++r) {
+            if (!runs.contains(r.key())) {
+                while (runs.size() >= kMaxRunsPerFile) runs.erase(runs.begin());
+            }
+            runs.insert(r.key(), toJson(r.value()));
+        }
+
+        QJsonObject root;
+        root.insert("v", double(barsVersion));
+        root.insert("runs", runs);
+        QSaveFile f(filePath(code));
+        if (!f.open(QIODevice::WriteOnly)) continue;
+        f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        f.commit();
+    }
+}
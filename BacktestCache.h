@@ -0,0 +1,46 @@
+#pragma once
+
+#include "BacktestEngine.h"
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+// 单只股票推演结果的备忘缓存：键为 (代码, 区间, 规则参数, K线版本)。
+// 内存里用 QCache 按体积淘汰，磁盘上每只股票一个文件（AppData/backtests/<code>.json）。
+// insert 只进内存并记下待写，flush 时每只股票写一次；K线版本变化后旧结果自然失配，落盘时顺带清掉
+class BacktestCache
+{
+public:
+    static BacktestCache& instance();
+
+    static QString key(const QString& code, const QDate& startDate, const QDate& endDate,
+                       const BacktestParams& params, quint64 barsVersion);
+
+    bool lookup(const QString& code, quint64 barsVersion, const QString& key, SymbolBacktest* out);
+    // 可在并行任务里调用：只持锁改内存，不碰磁盘
+    void insert(const QString& code, quint64 barsVersion, const QString& key, const SymbolBacktest& result);
+    // 把 insert 攒下的结果按股票合并写盘；I/O 不持锁。在并行任务全部结束后调用
+    void flush();
+
+    // 内存软上限（字节，0 = 不限），超出部分按 QCache 的最久未用淘汰；磁盘上的结果不受影响
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryBytes();
+
+private:
+    BacktestCache();
+
+    QString filePath(const QString& code) const;
+    void loadFromDisk(const QString& code, quint64 barsVersion);
+
+    QMutex m_mutex;
+    QCache<QString, SymbolBacktest> m_memory;
+    QHash<QString, quint64> m_diskLoaded;   // 已把磁盘上该版本的结果读进内存
+
+    struct DirtyRuns {
+        quint64 barsVersion = 0;
+        QHash<QString, SymbolBacktest> runs;
+    };
+    QHash<QString, DirtyRuns> m_dirty;      // code -> 待写盘的结果
+};
@@ -0,0 +1,198 @@
+#include "BacktestEngine.h"
+#include "BacktestCache.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+QVector<double> BacktestEngine::movingAverage(const QVector<double>& closes, int window)
+{
+    const int n = closes.size();
+    QVector<double> out(n, std::numeric_limits<double>::quiet_NaN());
+    if (window <= 0) return out;
+    for (int i = window - 1; i < n; ++i) {
+        double sum = 0;
+        for (int j = i - window + 1; j <= i; ++j) sum += closes[j];
+        out[i] = sum / window;
+    }
+    return out;
+}
+
+bool BacktestEngine::prepare(const QString& code, const DailyBars& bars, const QDate& startDate,
+                             const QDate& endDate, PreparedSeries* out, QString* error)
+{
+    if (!bars.isConsistent() || bars.isEmpty()) {
+        if (error) *error = "K线数据格式异常。";
+        return false;
+    }
+
+    PreparedSeries& s = *out;
+    s.code = code;
+    s.closes = bars.closes;
+    s.ma5 = movingAverage(bars.closes, 5);
+
+    const auto& dates = bars.dates;
+    const int n = s.closes.size();
+    s.startIndex = -1;
+    s.endIndex = -1;
+    for (int i = 0; i < n; ++i) {
+        if (dates[i].isValid() && dates[i] >= startDate && s.startIndex < 0) s.startIndex = i;
+        if (dates[i].isValid() && dates[i] <= endDate) s.endIndex = i;
+    }
+    if (s.startIndex < 0 || s.endIndex < s.startIndex) {
+        if (error) *error = "指定日期范围内没有数据。";
+        return false;
+    }
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    s.risePct = QVector<double>(n, nan);
+    s.belowStreak = QVector<int>(n, 0);
+    s.ma5Rising = QVector<char>(n, 0);
+    for (int i = 0; i < n; ++i) {
+        const double c = s.closes[i];
+        const double ma = s.ma5[i];
+        const bool below = (i >= 4 && !std::isnan(ma) && c < ma);
+        s.belowStreak[i] = below ? ((i > 0 ? s.belowStreak[i - 1] : 0) + 1) : 0;
+        if (i > 0) {
+            const double prevMa = s.ma5[i - 1];
+            s.ma5Rising[i] = (!std::isnan(ma) && !std::isnan(prevMa) && ma > prevMa) ? 1 : 0;
+            if (s.closes[i - 1] > 0) s.risePct[i] = (c / s.closes[i - 1] - 1.0) * 100.0;
+        }
+    }
+    return true;
+}
+
+void BacktestEngine::simulate(const PreparedSeries& s, const BacktestParams& params,
+                              SymbolBacktest& res, bool detail)
+{
+    const auto& closes = s.closes;
+    const int startIndex = s.startIndex;
+    const int endIndex = s.endIndex;
+    res.startIndex = startIndex;
+    res.endIndex = endIndex;
+
+    // 以 endIdx 结尾的连续 days 日收盘 < MA5：查 streak 即可，每根K线 O(1)
+    const auto allBelowMa5 = [&](int endIdx, int days) -> bool {
+        return days > 0 && endIdx >= 0 && s.belowStreak[endIdx] >= days;
+    };
+
+    bool inPosition = false;
+    double entry = 0.0;
+    int entryIndex = -1;
+    double equity = 1.0;
+    double peak = 1.0;
+    if (detail) res.equity.reserve(endIndex - startIndex + 1);
+
+    const auto closeTrade = [&](int i) {
+        const double ret = (closes[i] / entry - 1.0) * 100.0;
+        ++res.tradeCount;
+        if (ret > 0) ++res.wins;
+        res.tradeReturnSumPct += ret;
+        if (detail) {
+            BacktestTrade t;
+            t.buyIndex = entryIndex;
+            t.sellIndex = i;
+            t.entry = entry;
+            t.exit = closes[i];
+            t.returnPct = ret;
+            res.trades.push_back(t);
+        }
+        equity *= closes[i] / entry;
+        inPosition = false;
+    };
+
+    for (int i = startIndex; i <= endIndex; ++i) {
+        if (i >= 4) {
+            const bool buyWindowBelow = allBelowMa5(i - 1, params.buyBelowDays);
+            const bool buyRiseOk = !std::isnan(s.risePct[i]) && s.risePct[i] <= params.buyMaxRisePct;
+            if (!inPosition && buyWindowBelow && closes[i] > s.ma5[i] && s.ma5Rising[i] && buyRiseOk) {
+                inPosition = true;
+                entry = closes[i];
+                entryIndex = i;
+            } else if (inPosition && allBelowMa5(i, params.sellBelowDays)) {
+                closeTrade(i);
+            }
+        }
+
+        // 逐日净值：持仓中按当日收盘盯市
+        const double mark = inPosition ? equity * closes[i] / entry : equity;
+        if (detail) res.equity.push_back(mark);
+        peak = std::max(peak, mark);
+        if (peak > 0) res.maxDrawdownPct = std::max(res.maxDrawdownPct, (1.0 - mark / peak) * 100.0);
+    }
+
+    if (inPosition) closeTrade(endIndex);
+
+    res.totalReturnPct = (equity - 1.0) * 100.0;
+    res.ok = true;
+}
+
+SymbolBacktest BacktestEngine::runSymbol(const QString& code, const DailyBars& bars,
+                                         const QDate& startDate, const QDate& endDate,
+                                         const BacktestParams& params)
+{
+    SymbolBacktest res;
+    res.code = code;
+    PreparedSeries series;
+    if (!prepare(code, bars, startDate, endDate, &series, &res.error)) return res;
+    simulate(series, params, res, true);
+    return res;
+}
+
+BacktestSummary BacktestEngine::runUniverse(const QStringList& codes, const QDate& startDate,
+                                            const QDate& endDate, const BacktestParams& params)
+{
+    const BarStore& store = BarStore::instance();
+    const QStringList universe = codes.isEmpty() ? store.codes() : codes;
+
+    BacktestCache& cache = BacktestCache::instance();
+
+    // 各股票互不依赖：按核数并行，每个任务只读自己那份 bars；
+    // 同一份K线、同一组参数推演过的直接取缓存
+    const QVector<SymbolBacktest> results = QtConcurrent::blockingMapped<QVector<SymbolBacktest>>(
+        universe, [&](const QString& code) {
+            DailyBars bars;
+            quint64 version = 0;
+            if (!store.get(code, &bars, &version)) {
+                SymbolBacktest missing;
+                missing.code = code;
+                missing.error = "本地无K线数据。";
+                return missing;
+            }
+            const QString key = BacktestCache::key(code, startDate, endDate, params, version);
+            SymbolBacktest res;
+            if (cache.lookup(code, version, key, &res)) return res;
+            res = runSymbol(code, bars, startDate, endDate, params);
+            cache.insert(code, version, key, res);
+            return res;
+        });
+    // 并行阶段只进内存；每只股票的结果在这里一次写盘
+    cache.flush();
+    return summarize(results);
+}
+
+BacktestSummary BacktestEngine::summarize(const QVector<SymbolBacktest>& results)
+{
+    BacktestSummary sum;
+    sum.perSymbol = results;
+
+    double tradeReturnSum = 0;
+    double symbolReturnSum = 0;
+    for (const auto& r : results) {
+        if (!r.ok) continue;
+        ++sum.symbols;
+        symbolReturnSum += r.totalReturnPct;
+        sum.maxDrawdownPct = std::max(sum.maxDrawdownPct, r.maxDrawdownPct);
+        if (r.tradeCount > 0) ++sum.tradedSymbols;
+        sum.trades += r.tradeCount;
+        sum.wins += r.wins;
+        tradeReturnSum += r.tradeReturnSumPct;
+    }
+    if (sum.trades > 0) {
+        sum.winRatePct = 100.0 * sum.wins / sum.trades;
+        sum.avgTradeReturnPct = tradeReturnSum / sum.trades;
+    }
+    if (sum.symbols > 0) sum.avgSymbolReturnPct = symbolReturnSum / sum.symbols;
+    return sum;
+}
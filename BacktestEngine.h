@@ -0,0 +1,83 @@
+#pragma once
+
+#include "BarStore.h"
+
+#include <QDate>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct BacktestParams {
+    int buyBelowDays = 3;         // 买入：前 N 日收盘 < MA5
+    int sellBelowDays = 1;        // 卖出：含当日连续 N 日收盘 < MA5
+    double buyMaxRisePct = 9.90;  // 买入当日涨幅上限
+};
+
+struct BacktestTrade {
+    int buyIndex = -1;              // bars 中的下标，画图时才换成时间戳
+    int sellIndex = -1;
+    double entry = 0;
+    double exit = 0;
+    double returnPct = 0;
+};
+
+struct SymbolBacktest {
+    QString code;
+    bool ok = false;
+    QString error;
+    int startIndex = -1;            // 推演区间在 bars 中的下标
+    int endIndex = -1;
+    QVector<BacktestTrade> trades;
+    QVector<double> equity;         // 区间内逐日净值（持仓按收盘价盯市），起点 1.0
+    double totalReturnPct = 0;
+    double maxDrawdownPct = 0;
+    int tradeCount = 0;
+    int wins = 0;
+    double tradeReturnSumPct = 0;   // 各笔收益率之和，用于跨股票求平均
+};
+
+// 与规则参数无关的指标：寻优时每只股票只算一次，各线程只读共享
+struct PreparedSeries {
+    QString code;
+    int startIndex = -1;
+    int endIndex = -1;
+    QVector<double> closes;
+    QVector<double> ma5;
+    QVector<double> risePct;        // 当日涨幅 %，无有效前收为 NaN
+    QVector<int> belowStreak;       // 截至当日连续收盘 < MA5 的天数
+    QVector<char> ma5Rising;
+};
+
+struct BacktestSummary {
+    int symbols = 0;                // 有效推演的股票数
+    int tradedSymbols = 0;
+    int trades = 0;
+    int wins = 0;
+    double winRatePct = 0;
+    double avgTradeReturnPct = 0;
+    double avgSymbolReturnPct = 0;
+    double maxDrawdownPct = 0;      // 各股票净值回撤的最大值
+    QVector<SymbolBacktest> perSymbol;
+};
+
+// 无界面的 MA5 推演引擎：单只或整批股票（BarStore 中的数据）并行推演
+class BacktestEngine
+{
+public:
+    static SymbolBacktest runSymbol(const QString& code, const DailyBars& bars,
+                                    const QDate& startDate, const QDate& endDate,
+                                    const BacktestParams& params);
+
+    static bool prepare(const QString& code, const DailyBars& bars, const QDate& startDate,
+                        const QDate& endDate, PreparedSeries* out, QString* error);
+    // detail=false 时不记录逐笔交易与净值曲线，只算统计（寻优用）
+    static void simulate(const PreparedSeries& series, const BacktestParams& params,
+                         SymbolBacktest& res, bool detail);
+
+    // codes 为空时跑 BarStore 中的全部股票
+    static BacktestSummary runUniverse(const QStringList& codes, const QDate& startDate,
+                                       const QDate& endDate, const BacktestParams& params);
+
+    static BacktestSummary summarize(const QVector<SymbolBacktest>& results);
+    static QVector<double> movingAverage(const QVector<double>& closes, int window);
+};
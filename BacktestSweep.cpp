@@ -0,0 +1,81 @@
+#include "BacktestSweep.h"
+
+#include <QRandomGenerator>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+
+namespace {
+double riseAt(const SweepRange& range, int step)
+{
+    if (range.riseSteps <= 1) return range.riseMax;
+    return range.riseMin + (range.riseMax - range.riseMin) * step / (range.riseSteps - 1);
+}
+}
+
+QVector<BacktestParams> BacktestSweep::gridParams(const SweepRange& range)
+{
+    QVector<BacktestParams> out;
+    const int steps = std::max(1, range.riseSteps);
+    out.reserve((range.buyBelowMax - range.buyBelowMin + 1) * (range.sellBelowMax - range.sellBelowMin + 1) * steps);
+    for (int b = range.buyBelowMin; b <= range.buyBelowMax; ++b) {
+        for (int s = range.sellBelowMin; s <= range.sellBelowMax; ++s) {
+            for (int r = 0; r < steps; ++r) {
+                BacktestParams p;
+                p.buyBelowDays = b;
+                p.sellBelowDays = s;
+                p.buyMaxRisePct = riseAt(range, r);
+                out.push_back(p);
+            }
+        }
+    }
+    return out;
+}
+
+QVector<BacktestParams> BacktestSweep::randomParams(const SweepRange& range, int count, quint32 seed)
+{
+    QRandomGenerator rng(seed);
+    QVector<BacktestParams> out;
+    out.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        BacktestParams p;
+        p.buyBelowDays = rng.bounded(range.buyBelowMin, range.buyBelowMax + 1);
+        p.sellBelowDays = rng.bounded(range.sellBelowMin, range.sellBelowMax + 1);
+        p.buyMaxRisePct = range.riseMin + rng.generateDouble() * (range.riseMax - range.riseMin);
+        out.push_back(p);
+    }
+    return out;
+}
+
+QVector<SweepResult> BacktestSweep::run(const QVector<PreparedSeries>& series,
+                                        const QVector<BacktestParams>& params)
+{
+    QVector<SweepResult> results = QtConcurrent::blockingMapped<QVector<SweepResult>>(
+        params, [&series](const BacktestParams& p) {
+            SweepResult out;
+            out.params = p;
+            int wins = 0;
+            double tradeReturnSum = 0;
+            double returnSum = 0;
+            for (const auto& s : series) {
+                SymbolBacktest res;
+                BacktestEngine::simulate(s, p, res, false);
+                ++out.symbols;
+                out.trades += res.tradeCount;
+                wins += res.wins;
+                tradeReturnSum += res.tradeReturnSumPct;
+                returnSum += res.totalReturnPct;
+                out.maxDrawdownPct = std::max(out.maxDrawdownPct, res.maxDrawdownPct);
+            }
+            if (out.trades > 0) {
+                out.winRatePct = 100.0 * wins / out.trades;
+                out.avgTradeReturnPct = tradeReturnSum / out.trades;
+            }
+            if (out.symbols > 0) out.avgReturnPct = returnSum / out.symbols;
+            return out;
+        });
+
+    std::sort(results.begin(), results.end(), [](const SweepResult& a, const SweepResult& b) {
+        return a.avgReturnPct > b.avgReturnPct;
+    });
+    return results;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "BacktestEngine.h"
+
+#include <QVector>
+
+// 参数寻优的搜索空间：整数 N 取闭区间，涨幅上限在 [riseMin, riseMax] 上等分 riseSteps 个点
+struct SweepRange {
+    int buyBelowMin = 1;
+    int buyBelowMax = 8;
+    int sellBelowMin = 1;
+    int sellBelowMax = 8;
+    double riseMin = 0.5;
+    double riseMax = 10.0;
+    int riseSteps = 20;
+};
+
+struct SweepResult {
+    BacktestParams params;
+    int symbols = 0;
+    int trades = 0;
+    double winRatePct = 0;
+    double avgTradeReturnPct = 0;
+    double avgReturnPct = 0;        // 各股票区间收益的平均
+    double maxDrawdownPct = 0;
+};
+
+class BacktestSweep
+{
+public:
+    static QVector<BacktestParams> gridParams(const SweepRange& range);
+    static QVector<BacktestParams> randomParams(const SweepRange& range, int count, quint32 seed);
+
+    // 指标已预先算好，按参数组合并行；结果按平均收益降序
+    static QVector<SweepResult> run(const QVector<PreparedSeries>& series,
+                                    const QVector<BacktestParams>& params);
+};
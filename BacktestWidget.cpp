@@ -7,17 +7,16 @@
 #include <QMessageBox>
 #include <QSpinBox>
 #include <QDoubleSpinBox>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QRegularExpression>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QGridLayout>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
-#include <QNetworkRequest>
-#include <QUrl>
-#include <QUrlQuery>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
 #include <QDateTime>
 #include <QChart>
 #include <QChartView>
@@ -27,37 +26,13 @@
 #include <QScatterSeries>
 #include <QDateTimeAxis>
 #include <QValueAxis>
+#include <QTimer>
+#include <QSignalBlocker>
+#include "ChartLod.h"
 #include <algorithm>
 #include <cmath>
 #include <limits>
 
-namespace {
-static const char* kEM_UT = "fa5fd1943c7b386f172d6893dbfba10b";
-
-static void FillCommonHeaders(QNetworkRequest& req) {
-    req.setRawHeader("User-Agent", "Mozilla/5.0");
-    req.setRawHeader("Accept", "application/json,text/plain,*/*");
-    req.setRawHeader("Accept-Language", "zh-CN,zh;q=0.9,en;q=0.8");
-    req.setRawHeader("Referer", "https://quote.eastmoney.com/");
-}
-
-static QList<int> marketsForCode(const QString& code) {
-    QList<int> markets;
-    if (code.startsWith("6")) {
-        markets << 1;
-    } else if (code.startsWith("8") || code.startsWith("4") || code.startsWith("43")
-               || code.startsWith("83") || code.startsWith("87") || code.startsWith("88")) {
-        markets << 2;
-    } else {
-        markets << 0;
-    }
-    if (!markets.contains(0)) markets << 0;
-    if (!markets.contains(1)) markets << 1;
-    if (!markets.contains(2)) markets << 2;
-    return markets;
-}
-}
-
 BacktestWidget::BacktestWidget(QWidget* parent)
     : QWidget(parent)
 {
@@ -66,7 +41,7 @@ BacktestWidget::BacktestWidget(QWidget* parent)
 
     auto* codeLabel = new QLabel("股票代码:", this);
     m_codeEdit = new QLineEdit(this);
-    m_codeEdit->setPlaceholderText("例如 600519");
+    m_codeEdit->setPlaceholderText("例如 600519，多只用逗号/空格分隔");
 
     auto* startLabel = new QLabel("开始日期:", this);
     m_startDateEdit = new QDateEdit(this);
@@ -80,6 +55,7 @@ BacktestWidget::BacktestWidget(QWidget* parent)
     m_endDateEdit->setDate(QDate::currentDate());
     m_endDateEdit->setDisplayFormat("yyyy-MM-dd");
 
+    m_universeCheck = new QCheckBox("全部已缓存股票", this);
     m_runButton = new QPushButton("开始推演", this);
 
     auto* buyBelowLabel = new QLabel("买入:前N日<MA5", this);
@@ -112,33 +88,69 @@ BacktestWidget::BacktestWidget(QWidget* parent)
     formLayout->addWidget(m_buyMaxRiseSpin, 1, 3);
     formLayout->addWidget(sellBelowLabel, 1, 4);
     formLayout->addWidget(m_sellBelowDaysSpin, 1, 5);
+    formLayout->addWidget(m_universeCheck, 1, 6);
+
+    auto* sweepLabel = new QLabel("参数寻优:", this);
+    m_sweepModeCombo = new QComboBox(this);
+    m_sweepModeCombo->addItem("网格 8×8×20");
+    m_sweepModeCombo->addItem("随机 2000 组");
+    m_sweepButton = new QPushButton("开始寻优", this);
+    formLayout->addWidget(sweepLabel, 2, 0);
+    formLayout->addWidget(m_sweepModeCombo, 2, 1);
+    formLayout->addWidget(m_sweepButton, 2, 2);
 
     m_summaryLabel = new QLabel("请输入代码与日期范围后开始推演。", this);
 
     m_chartView = new QChartView(this);
     m_chartView->setRenderHint(QPainter::Antialiasing);
+    m_chartView->setRubberBand(QChartView::HorizontalRubberBand);
+    setupChart();
 
     topLayout->addLayout(formLayout);
     topLayout->addWidget(m_summaryLabel);
     topLayout->addWidget(m_chartView);
 
-    m_nam = new QNetworkAccessManager(this);
+    m_fetcher = new BarFetcher(this);
+    m_watcher = new QFutureWatcher<BacktestSummary>(this);
+    m_sweepWatcher = new QFutureWatcher<QVector<SweepResult>>(this);
 
-    connect(m_runButton, &QPushButton::clicked, this, &BacktestWidget::startRequest);
+    connect(m_fetcher, &BarFetcher::progress, this, [this](const QString& code, int done, int total) {
+        m_summaryLabel->setText(QString("正在拉取 %1 的K线数据：%2/%3 段（剩余 %4 只）")
+                                .arg(code).arg(done).arg(total).arg(m_pendingCodes.size()));
+    });
+    connect(m_fetcher, &BarFetcher::finished, this, [this](const QString& code, bool ok, const QString&) {
+        // 部分区间失败时已拉到的数据仍可用，只有完全没有数据才算失败
+        if (!ok && !BarStore::instance().contains(code)) m_failedCodes << code;
+        m_pendingCodes.removeAll(code);
+        fetchNextCode();
+    });
+    connect(m_runButton, &QPushButton::clicked, this, [this]() { startRequest(false); });
+    connect(m_sweepButton, &QPushButton::clicked, this, [this]() { startRequest(true); });
+    connect(m_watcher, &QFutureWatcher<BacktestSummary>::finished, this, [this]() {
+        showSummary(m_watcher->result());
+    });
+    connect(m_sweepWatcher, &QFutureWatcher<QVector<SweepResult>>::finished, this, [this]() {
+        showSweepResults(m_sweepWatcher->result());
+    });
 }
 
 void BacktestWidget::setBusy(bool busy)
 {
     m_runButton->setEnabled(!busy);
+    m_sweepButton->setEnabled(!busy);
 }
 
-void BacktestWidget::startRequest()
+BacktestParams BacktestWidget::currentParams() const
+{
+    BacktestParams p;
+    p.buyBelowDays = m_buyBelowDaysSpin ? m_buyBelowDaysSpin->value() : 3;
+    p.sellBelowDays = m_sellBelowDaysSpin ? m_sellBelowDaysSpin->value() : 1;
+    p.buyMaxRisePct = m_buyMaxRiseSpin ? m_buyMaxRiseSpin->value() : 100.0;
+    return p;
+}
+
+void BacktestWidget::startRequest(bool sweep)
 {
-    const QString code = m_codeEdit->text().trimmed();
-    if (code.isEmpty()) {
-        QMessageBox::warning(this, "推演", "请输入股票代码");
-        return;
-    }
     const QDate startDate = m_startDateEdit->date();
     const QDate endDate = m_endDateEdit->date();
     if (startDate > endDate) {
@@ -146,283 +158,350 @@ void BacktestWidget::startRequest()
         return;
     }
 
-    if (m_reply) {
-        m_reply->abort();
-        m_reply->deleteLater();
-        m_reply = nullptr;
+    QStringList codes;
+    if (m_universeCheck->isChecked()) {
+        codes = BarStore::instance().codes();
+        if (codes.isEmpty()) {
+            QMessageBox::warning(this, "推演", "本地暂无已缓存的K线数据");
+            return;
+        }
+        codes.sort();
+    } else {
+        codes = m_codeEdit->text().split(QRegularExpression("[,，;；\\s]+"), Qt::SkipEmptyParts);
+        codes.removeDuplicates();
+        if (codes.isEmpty()) {
+            QMessageBox::warning(this, "推演", "请输入股票代码");
+            return;
+        }
     }
 
+    m_fetcher->cancel();
+
     setBusy(true);
-    m_summaryLabel->setText(QString("正在拉取 %1 的K线数据...").arg(code));
-    const QList<int> markets = marketsForCode(code);
-    requestKline(code, startDate, endDate, markets, 0);
+    m_runCodes = codes;
+    m_runStart = startDate;
+    m_runEnd = endDate;
+    m_failedCodes.clear();
+    m_sweepPending = sweep;
+    // 全市场模式只用本地数据；自选股逐只补齐缺口后入库（已覆盖的区间不再请求）
+    m_pendingCodes = m_universeCheck->isChecked() ? QStringList() : codes;
+    fetchNextCode();
 }
 
-void BacktestWidget::requestKline(const QString& code, const QDate& startDate, const QDate& endDate,
-                                  const QList<int>& markets, int marketIndex)
+void BacktestWidget::fetchNextCode()
 {
-    if (marketIndex >= markets.size()) {
+    if (m_pendingCodes.isEmpty()) {
+        if (m_sweepPending) runSweep();
+        else runEngine();
+        return;
+    }
+    const QString code = m_pendingCodes.first();
+    m_summaryLabel->setText(QString("正在拉取 %1 的K线数据...（剩余 %2 只）").arg(code).arg(m_pendingCodes.size()));
+    // 多拉 20 天供 MA5 预热
+    m_fetcher->fetch(code, m_runStart.addDays(-20), m_runEnd);
+}
+
+void BacktestWidget::runEngine()
+{
+    QStringList codes = m_runCodes;
+    for (const auto& c : m_failedCodes) codes.removeAll(c);
+    if (codes.isEmpty()) {
         setBusy(false);
         m_summaryLabel->setText("无法获取K线数据，请检查代码是否正确。");
         return;
     }
 
-    const QString secid = QString("%1.%2").arg(markets[marketIndex]).arg(code);
-    const QDate fetchStart = startDate.addDays(-20);
-
-    QUrl url("https://push2his.eastmoney.com/api/qt/stock/kline/get");
-    QUrlQuery q;
-    q.addQueryItem("secid", secid);
-    q.addQueryItem("klt", "101");
-    q.addQueryItem("fqt", "0");
-    q.addQueryItem("beg", fetchStart.toString("yyyyMMdd"));
-    q.addQueryItem("end", endDate.toString("yyyyMMdd"));
-    q.addQueryItem("lmt", "500");
-    q.addQueryItem("rtntype", "6");
-    q.addQueryItem("ut", kEM_UT);
-    q.addQueryItem("fields1", "f1,f2,f3,f4");
-    q.addQueryItem("fields2", "f51,f52,f53,f54,f55");
-    url.setQuery(q);
-
-    QNetworkRequest req(url);
-    FillCommonHeaders(req);
-
-    m_reply = m_nam->get(req);
-    connect(m_reply, &QNetworkReply::finished, this, [this, code, startDate, endDate, markets, marketIndex]() {
-        const QByteArray raw = m_reply->readAll();
-        const auto err = m_reply->error();
-        m_reply->deleteLater();
-        m_reply = nullptr;
-
-        QVector<QString> dates;
-        QVector<double> opens;
-        QVector<double> closes;
-        QVector<double> highs;
-        QVector<double> lows;
-
-        auto parseOk = [&]() -> bool {
-            if (err != QNetworkReply::NoError) return false;
-            auto doc = QJsonDocument::fromJson(raw);
-            if (!doc.isObject()) return false;
-            const auto root = doc.object();
-            const auto dataVal = root.value("data");
-            if (!dataVal.isObject()) return false;
-            const auto data = dataVal.toObject();
-            const auto kl = data.value("klines");
-            if (!kl.isArray()) return false;
-            const auto arr = kl.toArray();
-            if (arr.isEmpty()) return false;
-            for (auto v : arr) {
-                const auto s = v.toString();
-                const auto parts = s.split(',');
-                if (parts.size() < 5) continue;
-                dates.push_back(parts[0]);
-                opens.push_back(parts[1].toDouble());
-                closes.push_back(parts[2].toDouble());
-                highs.push_back(parts[3].toDouble());
-                lows.push_back(parts[4].toDouble());
-            }
-            return !dates.isEmpty();
-        }();
-
-        if (!parseOk) {
-            requestKline(code, startDate, endDate, markets, marketIndex + 1);
-            return;
-        }
-
-        renderBacktest(code, startDate, endDate, dates, opens, closes, highs, lows);
-    });
+    m_summaryLabel->setText(QString("正在推演 %1 只股票...").arg(codes.size()));
+    const QDate startDate = m_runStart;
+    const QDate endDate = m_runEnd;
+    const BacktestParams params = currentParams();
+    m_watcher->setFuture(QtConcurrent::run([codes, startDate, endDate, params]() {
+        return BacktestEngine::runUniverse(codes, startDate, endDate, params);
+    }));
 }
 
-void BacktestWidget::renderBacktest(const QString& code, const QDate& startDate, const QDate& endDate,
-                                    const QVector<QString>& dates, const QVector<double>& opens,
-                                    const QVector<double>& closes, const QVector<double>& highs,
-                                    const QVector<double>& lows)
+void BacktestWidget::runSweep()
 {
-    setBusy(false);
-    if (dates.size() != closes.size() || closes.size() != opens.size() || closes.size() != highs.size()
-        || closes.size() != lows.size()) {
-        m_summaryLabel->setText("K线数据格式异常。");
+    // 与参数无关的指标先按股票算好，所有组合共享
+    QVector<PreparedSeries> series;
+    for (const auto& code : m_runCodes) {
+        if (m_failedCodes.contains(code)) continue;
+        DailyBars bars;
+        PreparedSeries prepared;
+        if (BarStore::instance().get(code, &bars)
+            && BacktestEngine::prepare(code, bars, m_runStart, m_runEnd, &prepared, nullptr)) {
+            series.push_back(prepared);
+        }
+    }
+    if (series.isEmpty()) {
+        setBusy(false);
+        m_summaryLabel->setText("没有可用于寻优的K线数据。");
         return;
     }
 
-    QVector<QDate> barDates;
-    barDates.reserve(dates.size());
-    for (const auto& s : dates) {
-        barDates.push_back(QDate::fromString(s, "yyyy-MM-dd"));
+    SweepRange range;
+    const QVector<BacktestParams> params = (m_sweepModeCombo->currentIndex() == 0)
+        ? BacktestSweep::gridParams(range)
+        : BacktestSweep::randomParams(range, 2000, quint32(QDateTime::currentMSecsSinceEpoch()));
+
+    m_sweepCombos = params.size();
+    m_sweepStartedMs = QDateTime::currentMSecsSinceEpoch();
+    m_summaryLabel->setText(QString("正在寻优：%1 只股票 × %2 组参数...").arg(series.size()).arg(params.size()));
+    m_sweepWatcher->setFuture(QtConcurrent::run([series, params]() {
+        return BacktestSweep::run(series, params);
+    }));
+}
+
+void BacktestWidget::showSweepResults(const QVector<SweepResult>& results)
+{
+    setBusy(false);
+    const qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - m_sweepStartedMs;
+    m_summaryLabel->setText(QString("寻优完成：%1 组参数，用时 %2 ms。双击结果行可套用参数。")
+                            .arg(m_sweepCombos).arg(elapsed));
+
+    if (!m_sweepDialog) {
+        m_sweepDialog = new QDialog(this);
+        m_sweepDialog->setWindowTitle("参数寻优结果");
+        m_sweepDialog->resize(820, 520);
+        auto* layout = new QVBoxLayout(m_sweepDialog);
+        m_sweepTable = new QTableWidget(m_sweepDialog);
+        m_sweepTable->setColumnCount(8);
+        m_sweepTable->setHorizontalHeaderLabels({"买入N", "卖出N", "涨幅上限%", "交易次数", "胜率%",
+                                                 "平均每笔%", "平均收益%", "最大回撤%"});
+        m_sweepTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        m_sweepTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+        m_sweepTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+        layout->addWidget(m_sweepTable);
+
+        connect(m_sweepTable, &QTableWidget::cellDoubleClicked, this, [this](int row, int) {
+            m_buyBelowDaysSpin->setValue(m_sweepTable->item(row, 0)->text().toInt());
+            m_sellBelowDaysSpin->setValue(m_sweepTable->item(row, 1)->text().toInt());
+            m_buyMaxRiseSpin->setValue(m_sweepTable->item(row, 2)->text().toDouble());
+        });
     }
 
-    const int n = closes.size();
-    QVector<double> ma5(n, std::numeric_limits<double>::quiet_NaN());
-    QVector<double> ma10(n, std::numeric_limits<double>::quiet_NaN());
-    QVector<double> ma20(n, std::numeric_limits<double>::quiet_NaN());
-    for (int i = 0; i < n; ++i) {
-        if (i >= 4) {
-            double sum = 0;
-            for (int j = i - 4; j <= i; ++j) sum += closes[j];
-            ma5[i] = sum / 5.0;
-        }
-        if (i >= 9) {
-            double sum = 0;
-            for (int j = i - 9; j <= i; ++j) sum += closes[j];
-            ma10[i] = sum / 10.0;
-        }
-        if (i >= 19) {
-            double sum = 0;
-            for (int j = i - 19; j <= i; ++j) sum += closes[j];
-            ma20[i] = sum / 20.0;
+    // 只列前 200 名，已按平均收益降序
+    const int rows = std::min<int>(results.size(), 200);
+    m_sweepTable->setRowCount(rows);
+    for (int i = 0; i < rows; ++i) {
+        const auto& r = results[i];
+        const QStringList cells = {
+            QString::number(r.params.buyBelowDays),
+            QString::number(r.params.sellBelowDays),
+            QString::number(r.params.buyMaxRisePct, 'f', 2),
+            QString::number(r.trades),
+            QString::number(r.winRatePct, 'f', 1),
+            QString::number(r.avgTradeReturnPct, 'f', 2),
+            QString::number(r.avgReturnPct, 'f', 2),
+            QString::number(r.maxDrawdownPct, 'f', 2),
+        };
+        for (int c = 0; c < cells.size(); ++c) {
+            m_sweepTable->setItem(i, c, new QTableWidgetItem(cells[c]));
         }
     }
+    m_sweepDialog->show();
+    m_sweepDialog->raise();
+}
+
+void BacktestWidget::showSummary(const BacktestSummary& summary)
+{
+    setBusy(false);
 
-    int startIndex = -1;
-    int endIndex = -1;
-    for (int i = 0; i < n; ++i) {
-        if (barDates[i].isValid() && barDates[i] >= startDate && startIndex < 0) startIndex = i;
-        if (barDates[i].isValid() && barDates[i] <= endDate) endIndex = i;
+    // 图表展示第一只推演成功的股票
+    const SymbolBacktest* first = nullptr;
+    for (const auto& r : summary.perSymbol) {
+        if (r.ok) { first = &r; break; }
     }
-    if (startIndex < 0 || endIndex < startIndex) {
-        m_summaryLabel->setText("指定日期范围内没有数据。");
+    if (!first) {
+        const QString error = summary.perSymbol.isEmpty() ? QString("没有可推演的数据。")
+                                                          : summary.perSymbol.first().error;
+        m_summaryLabel->setText(error);
         return;
     }
 
-    bool inPosition = false;
-    double entry = 0.0;
-    double equity = 1.0;
-    int tradeCount = 0;
-    QVector<QPointF> buyPoints;
-    QVector<QPointF> sellPoints;
-    const int buyBelowDays = m_buyBelowDaysSpin ? m_buyBelowDaysSpin->value() : 3;
-    const int sellBelowDays = m_sellBelowDaysSpin ? m_sellBelowDaysSpin->value() : 1;
-    const double buyMaxRisePct = m_buyMaxRiseSpin ? m_buyMaxRiseSpin->value() : 100.0;
-
-    for (int i = startIndex; i <= endIndex; ++i) {
-        if (i < 4) continue;
-        const auto allBelowMa5 = [&](int endIndex, int days) -> bool {
-            if (days <= 0) return false;
-            const int start = endIndex - days + 1;
-            if (start < 0) return false;
-            for (int j = start; j <= endIndex; ++j) {
-                if (j < 4 || std::isnan(ma5[j]) || closes[j] >= ma5[j]) {
-                    return false;
-                }
-            }
-            return true;
-        };
-
-        const bool buyWindowBelow = allBelowMa5(i - 1, buyBelowDays);
-        const bool ma5Rising = (i > 0 && !std::isnan(ma5[i]) && !std::isnan(ma5[i - 1]) && ma5[i] > ma5[i - 1]);
-        const bool buyRiseOk = (i > 0 && closes[i - 1] > 0)
-            ? ((closes[i] / closes[i - 1] - 1.0) * 100.0 <= buyMaxRisePct)
-            : false;
-        if (!inPosition && buyWindowBelow && closes[i] > ma5[i] && ma5Rising && buyRiseOk) {
-            inPosition = true;
-            entry = closes[i];
-            const qint64 ts = QDateTime(barDates[i].startOfDay()).toMSecsSinceEpoch();
-            buyPoints.push_back(QPointF(ts, closes[i]));
-        } else if (inPosition && allBelowMa5(i, sellBelowDays)) {
-            inPosition = false;
-            equity *= closes[i] / entry;
-            ++tradeCount;
-            const qint64 ts = QDateTime(barDates[i].startOfDay()).toMSecsSinceEpoch();
-            sellPoints.push_back(QPointF(ts, closes[i]));
-        }
+    QString text;
+    if (summary.perSymbol.size() == 1) {
+        text = QString("%1 推演完成：交易 %2 次，收益率 %3%，最大回撤 %4%")
+                   .arg(first->code)
+                   .arg(first->trades.size())
+                   .arg(QString::number(first->totalReturnPct, 'f', 2))
+                   .arg(QString::number(first->maxDrawdownPct, 'f', 2));
+    } else {
+        text = QString("%1 只股票推演完成：交易 %2 次，胜率 %3%，平均每笔 %4%，平均收益 %5%，最大回撤 %6%")
+                   .arg(summary.symbols)
+                   .arg(summary.trades)
+                   .arg(QString::number(summary.winRatePct, 'f', 1))
+                   .arg(QString::number(summary.avgTradeReturnPct, 'f', 2))
+                   .arg(QString::number(summary.avgSymbolReturnPct, 'f', 2))
+                   .arg(QString::number(summary.maxDrawdownPct, 'f', 2));
     }
-
-    if (inPosition) {
-        equity *= closes[endIndex] / entry;
-        ++tradeCount;
-        const qint64 ts = QDateTime(barDates[endIndex].startOfDay()).toMSecsSinceEpoch();
-        sellPoints.push_back(QPointF(ts, closes[endIndex]));
+    if (!m_failedCodes.isEmpty()) text += QString("（拉取失败：%1）").arg(m_failedCodes.join(","));
+    m_summaryLabel->setText(text);
+
+    // 逐只收益放在提示里
+    QStringList lines;
+    for (const auto& r : summary.perSymbol) {
+        if (!r.ok) continue;
+        lines << QString("%1  交易 %2 次  收益 %3%  回撤 %4%")
+                     .arg(r.code)
+                     .arg(r.trades.size())
+                     .arg(QString::number(r.totalReturnPct, 'f', 2))
+                     .arg(QString::number(r.maxDrawdownPct, 'f', 2));
     }
+    m_summaryLabel->setToolTip(lines.join("\n"));
 
-    const double pct = (equity - 1.0) * 100.0;
-    m_summaryLabel->setText(QString("%1 推演完成：交易 %2 次，收益率 %3%")
-                            .arg(code)
-                            .arg(tradeCount)
-                            .arg(QString::number(pct, 'f', 2)));
-
-    auto* chart = new QChart();
-    chart->setTitle(QString("%1 K线推演").arg(code));
+    DailyBars bars;
+    if (BarStore::instance().get(first->code, &bars)) renderChart(first->code, bars, *first);
+}
 
-    auto* candleSeries = new QCandlestickSeries();
-    candleSeries->setIncreasingColor(QColor("#d32f2f"));
-    candleSeries->setDecreasingColor(QColor("#2e7d32"));
+void BacktestWidget::setupChart()
+{
+    m_chart = new QChart();
+
+    m_candleSeries = new QCandlestickSeries();
+    m_candleSeries->setIncreasingColor(QColor("#d32f2f"));
+    m_candleSeries->setDecreasingColor(QColor("#2e7d32"));
+
+    m_ma5Series = new QLineSeries();
+    m_ma5Series->setName("MA5");
+    m_ma5Series->setColor(QColor("#ff9800"));
+
+    m_ma10Series = new QLineSeries();
+    m_ma10Series->setName("MA10");
+    m_ma10Series->setColor(QColor("#1976d2"));
+
+    m_ma20Series = new QLineSeries();
+    m_ma20Series->setName("MA20");
+    m_ma20Series->setColor(QColor("#7b1fa2"));
+
+    m_buySeries = new QScatterSeries();
+    m_buySeries->setName("买点");
+    m_buySeries->setColor(QColor("#2e7d32"));
+    m_buySeries->setMarkerSize(8.0);
+
+    m_sellSeries = new QScatterSeries();
+    m_sellSeries->setName("卖点");
+    m_sellSeries->setColor(QColor("#d32f2f"));
+    m_sellSeries->setMarkerSize(8.0);
+
+    m_chart->addSeries(m_candleSeries);
+    m_chart->addSeries(m_ma5Series);
+    m_chart->addSeries(m_ma10Series);
+    m_chart->addSeries(m_ma20Series);
+    m_chart->addSeries(m_buySeries);
+    m_chart->addSeries(m_sellSeries);
+
+    m_axisX = new QDateTimeAxis;
+    m_axisX->setFormat("yyyy-MM-dd");
+    m_axisX->setTickCount(8);
+    m_chart->addAxis(m_axisX, Qt::AlignBottom);
+
+    m_axisY = new QValueAxis;
+    m_axisY->setLabelFormat("%.2f");
+    m_chart->addAxis(m_axisY, Qt::AlignLeft);
+
+    for (auto* series : m_chart->series()) {
+        series->attachAxis(m_axisX);
+        series->attachAxis(m_axisY);
+    }
 
-    auto* ma5Series = new QLineSeries();
-    ma5Series->setName("MA5");
-    ma5Series->setColor(QColor("#ff9800"));
+    m_chart->legend()->setAlignment(Qt::AlignTop);
+    m_chartView->setChart(m_chart);
 
-    auto* ma10Series = new QLineSeries();
-    ma10Series->setName("MA10");
-    ma10Series->setColor(QColor("#1976d2"));
+    // 缩放 / 平移后合并成一次重新抽稀
+    m_lodTimer = new QTimer(this);
+    m_lodTimer->setSingleShot(true);
+    m_lodTimer->setInterval(30);
+    connect(m_lodTimer, &QTimer::timeout, this, &BacktestWidget::updateChartLod);
+    connect(m_axisX, &QDateTimeAxis::rangeChanged, m_lodTimer, [this]() { m_lodTimer->start(); });
+}
 
-    auto* ma20Series = new QLineSeries();
-    ma20Series->setName("MA20");
-    ma20Series->setColor(QColor("#7b1fa2"));
+void BacktestWidget::renderChart(const QString& code, const DailyBars& bars, const SymbolBacktest& result)
+{
+    m_chartCode = code;
+    m_chartBars = bars;
+    m_chartStart = result.startIndex;
+    m_chartEnd = result.endIndex;
+    m_chartMa5 = BacktestEngine::movingAverage(bars.closes, 5);
+    m_chartMa10 = BacktestEngine::movingAverage(bars.closes, 10);
+    m_chartMa20 = BacktestEngine::movingAverage(bars.closes, 20);
+
+    // 只在交给图表时把交易日下标换成时间戳，每根K线换一次
+    const auto& barDates = bars.dates;
+    m_chartStamps = QVector<qint64>(barDates.size(), 0);
+    for (int i = m_chartStart; i <= m_chartEnd; ++i) {
+        if (barDates[i].isValid()) m_chartStamps[i] = barDates[i].startOfDay().toMSecsSinceEpoch();
+    }
 
-    auto* buySeries = new QScatterSeries();
-    buySeries->setName("买点");
-    buySeries->setColor(QColor("#2e7d32"));
-    buySeries->setMarkerSize(8.0);
+    QList<QPointF> buyPoints;
+    QList<QPointF> sellPoints;
+    for (const auto& t : result.trades) {
+        buyPoints.push_back(QPointF(m_chartStamps[t.buyIndex], t.entry));
+        sellPoints.push_back(QPointF(m_chartStamps[t.sellIndex], t.exit));
+    }
+    m_buySeries->replace(buyPoints);
+    m_sellSeries->replace(sellPoints);
+
+    // 设 X 范围会触发 rangeChanged -> updateChartLod；这里直接刷新一次，不等定时器
+    {
+        const QSignalBlocker blocker(m_axisX);
+        m_chart->zoomReset();
+        m_axisX->setRange(QDateTime(barDates[m_chartStart].startOfDay()),
+                          QDateTime(barDates[m_chartEnd].startOfDay()));
+    }
+    updateChartLod();
+}
 
-    auto* sellSeries = new QScatterSeries();
-    sellSeries->setName("卖点");
-    sellSeries->setColor(QColor("#d32f2f"));
-    sellSeries->setMarkerSize(8.0);
+void BacktestWidget::updateChartLod()
+{
+    if (m_chartStart < 0 || m_chartEnd < m_chartStart) return;
+
+    // 可见区间 -> 下标区间（时间戳单调递增，二分）
+    const qint64 minTs = m_axisX->min().toMSecsSinceEpoch();
+    const qint64 maxTs = m_axisX->max().toMSecsSinceEpoch();
+    const auto first = m_chartStamps.begin() + m_chartStart;
+    const auto last = m_chartStamps.begin() + m_chartEnd + 1;
+    int from = int(std::lower_bound(first, last, minTs) - m_chartStamps.begin());
+    int to = int(std::upper_bound(first, last, maxTs) - m_chartStamps.begin()) - 1;
+    from = std::max(m_chartStart, from - 1);
+    to = std::min(m_chartEnd, to + 1);
+    if (to < from) return;
+
+    const int pixels = std::max(100, int(m_chart->plotArea().width()));
+    const auto period = ChartLod::choosePeriod(to - from + 1, pixels);
+    const auto candles = ChartLod::aggregate(m_chartBars.dates, m_chartStamps, m_chartBars.opens,
+                                             m_chartBars.highs, m_chartBars.lows, m_chartBars.closes,
+                                             from, to, period);
 
     double minPrice = std::numeric_limits<double>::max();
     double maxPrice = std::numeric_limits<double>::lowest();
-
-    for (int i = startIndex; i <= endIndex; ++i) {
-        if (!barDates[i].isValid()) continue;
-        const qint64 ts = QDateTime(barDates[i].startOfDay()).toMSecsSinceEpoch();
-        auto* set = new QCandlestickSet(opens[i], highs[i], lows[i], closes[i], ts);
-        candleSeries->append(set);
-        minPrice = std::min(minPrice, lows[i]);
-        maxPrice = std::max(maxPrice, highs[i]);
-        if (!std::isnan(ma5[i])) ma5Series->append(ts, ma5[i]);
-        if (!std::isnan(ma10[i])) ma10Series->append(ts, ma10[i]);
-        if (!std::isnan(ma20[i])) ma20Series->append(ts, ma20[i]);
+    QList<QCandlestickSet*> sets;
+    sets.reserve(candles.size());
+    for (const auto& c : candles) {
+        sets.push_back(new QCandlestickSet(c.open, c.high, c.low, c.close, c.ts));
+        minPrice = std::min(minPrice, c.low);
+        maxPrice = std::max(maxPrice, c.high);
     }
+    m_candleSeries->clear();
+    m_candleSeries->append(sets);
+
+    // 均线：每像素约 2 个点足够，LTTB 保留拐点
+    const int threshold = pixels * 2;
+    auto lineFor = [&](const QVector<double>& ma) {
+        QVector<QPointF> pts;
+        pts.reserve(to - from + 1);
+        for (int i = from; i <= to; ++i) {
+            if (m_chartBars.dates[i].isValid() && !std::isnan(ma[i])) pts.push_back(QPointF(m_chartStamps[i], ma[i]));
+        }
+        return ChartLod::lttb(pts, threshold);
+    };
+    m_ma5Series->replace(lineFor(m_chartMa5));
+    m_ma10Series->replace(lineFor(m_chartMa10));
+    m_ma20Series->replace(lineFor(m_chartMa20));
 
-    for (const auto& p : buyPoints) buySeries->append(p);
-    for (const auto& p : sellPoints) sellSeries->append(p);
-
-    chart->addSeries(candleSeries);
-    chart->addSeries(ma5Series);
-    chart->addSeries(ma10Series);
-    chart->addSeries(ma20Series);
-    chart->addSeries(buySeries);
-    chart->addSeries(sellSeries);
-
-    auto* axisX = new QDateTimeAxis;
-    axisX->setFormat("yyyy-MM-dd");
-    axisX->setTickCount(8);
-    axisX->setRange(QDateTime(barDates[startIndex].startOfDay()),
-                    QDateTime(barDates[endIndex].startOfDay()));
-    chart->addAxis(axisX, Qt::AlignBottom);
-    candleSeries->attachAxis(axisX);
-    ma5Series->attachAxis(axisX);
-    ma10Series->attachAxis(axisX);
-    ma20Series->attachAxis(axisX);
-    buySeries->attachAxis(axisX);
-    sellSeries->attachAxis(axisX);
-
-    auto* axisY = new QValueAxis;
-    axisY->setLabelFormat("%.2f");
+    m_chart->setTitle(QString("%1 K线推演（%2）").arg(m_chartCode, ChartLod::periodName(period)));
     if (minPrice < maxPrice) {
         const double padding = (maxPrice - minPrice) * 0.05;
-        axisY->setRange(minPrice - padding, maxPrice + padding);
+        m_axisY->setRange(minPrice - padding, maxPrice + padding);
     }
-    chart->addAxis(axisY, Qt::AlignLeft);
-    candleSeries->attachAxis(axisY);
-    ma5Series->attachAxis(axisY);
-    ma10Series->attachAxis(axisY);
-    ma20Series->attachAxis(axisY);
-    buySeries->attachAxis(axisY);
-    sellSeries->attachAxis(axisY);
-
-    chart->legend()->setAlignment(Qt::AlignTop);
-
-    m_chartView->setChart(chart);
 }
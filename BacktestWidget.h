@@ -4,17 +4,32 @@
 #include <QList>
 #include <QVector>
 #include <QString>
+#include <QStringList>
+#include <QDate>
+#include <QFutureWatcher>
+
+#include "BacktestEngine.h"
+#include "BacktestSweep.h"
+#include "BarFetcher.h"
 
-class QNetworkAccessManager;
-class QNetworkReply;
 class QLineEdit;
 class QDateEdit;
 class QPushButton;
 class QLabel;
 class QSpinBox;
 class QDoubleSpinBox;
-class QDate;
+class QCheckBox;
+class QComboBox;
+class QDialog;
+class QTableWidget;
 class QChartView;
+class QChart;
+class QCandlestickSeries;
+class QLineSeries;
+class QScatterSeries;
+class QDateTimeAxis;
+class QValueAxis;
+class QTimer;
 
 class BacktestWidget : public QWidget
 {
@@ -24,13 +39,16 @@ public:
 
 private:
     void setBusy(bool busy);
-    void startRequest();
-    void requestKline(const QString& code, const QDate& startDate, const QDate& endDate,
-                      const QList<int>& markets, int marketIndex);
-    void renderBacktest(const QString& code, const QDate& startDate, const QDate& endDate,
-                        const QVector<QString>& dates, const QVector<double>& opens,
-                        const QVector<double>& closes, const QVector<double>& highs,
-                        const QVector<double>& lows);
+    void startRequest(bool sweep);
+    void fetchNextCode();
+    void runEngine();
+    void runSweep();
+    void showSweepResults(const QVector<SweepResult>& results);
+    void showSummary(const BacktestSummary& summary);
+    void setupChart();
+    void renderChart(const QString& code, const DailyBars& bars, const SymbolBacktest& result);
+    void updateChartLod();
+    BacktestParams currentParams() const;
 
     QLineEdit* m_codeEdit = nullptr;
     QDateEdit* m_startDateEdit = nullptr;
@@ -38,9 +56,47 @@ private:
     QSpinBox* m_buyBelowDaysSpin = nullptr;
     QSpinBox* m_sellBelowDaysSpin = nullptr;
     QDoubleSpinBox* m_buyMaxRiseSpin = nullptr;
+    QCheckBox* m_universeCheck = nullptr;
     QPushButton* m_runButton = nullptr;
+    QComboBox* m_sweepModeCombo = nullptr;
+    QPushButton* m_sweepButton = nullptr;
     QLabel* m_summaryLabel = nullptr;
     QChartView* m_chartView = nullptr;
-    QNetworkAccessManager* m_nam = nullptr;
-    QNetworkReply* m_reply = nullptr;
+
+    // 图表对象只建一次，每次推演 / 缩放只替换数据
+    QChart* m_chart = nullptr;
+    QCandlestickSeries* m_candleSeries = nullptr;
+    QLineSeries* m_ma5Series = nullptr;
+    QLineSeries* m_ma10Series = nullptr;
+    QLineSeries* m_ma20Series = nullptr;
+    QScatterSeries* m_buySeries = nullptr;
+    QScatterSeries* m_sellSeries = nullptr;
+    QDateTimeAxis* m_axisX = nullptr;
+    QValueAxis* m_axisY = nullptr;
+    QTimer* m_lodTimer = nullptr;
+
+    // 当前图表的完整数据，LOD 按可见区间从这里重新抽取
+    QString m_chartCode;
+    DailyBars m_chartBars;
+    QVector<qint64> m_chartStamps;
+    QVector<double> m_chartMa5;
+    QVector<double> m_chartMa10;
+    QVector<double> m_chartMa20;
+    int m_chartStart = -1;
+    int m_chartEnd = -1;
+    BarFetcher* m_fetcher = nullptr;
+    QFutureWatcher<BacktestSummary>* m_watcher = nullptr;
+    QFutureWatcher<QVector<SweepResult>>* m_sweepWatcher = nullptr;
+    QDialog* m_sweepDialog = nullptr;
+    QTableWidget* m_sweepTable = nullptr;
+    qint64 m_sweepStartedMs = 0;
+    int m_sweepCombos = 0;
+
+    // 本次推演：代码列表（自选股）、待拉取队列与拉取失败的代码
+    QStringList m_runCodes;
+    QStringList m_pendingCodes;
+    QStringList m_failedCodes;
+    QDate m_runStart;
+    QDate m_runEnd;
+    bool m_sweepPending = false;
 };
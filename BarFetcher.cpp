@@ -0,0 +1,196 @@
+#include "BarFetcher.h"
+#include "KlineHub.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <algorithm>
+
+namespace {
+static const char* kKlineUrl = "https://push2his.eastmoney.com/api/qt/stock/kline/get";
+}
+
+BarFetcher::BarFetcher(QObject* parent)
+    : QObject(parent)
+{
+}
+
+QList<int> BarFetcher::marketsForCode(const QString& code)
+{
+    QList<int> markets;
+    if (code.startsWith("6")) {
+        markets << 1;
+    } else if (code.startsWith("8") || code.startsWith("4") || code.startsWith("43")
+               || code.startsWith("83") || code.startsWith("87") || code.startsWith("88")) {
+        markets << 2;
+    } else {
+        markets << 0;
+    }
+    if (!markets.contains(0)) markets << 0;
+    if (!markets.contains(1)) markets << 1;
+    if (!markets.contains(2)) markets << 2;
+    return markets;
+}
+
+void BarFetcher::fetch(const QString& code, const QDate& from, const QDate& to)
+{
+    cancel();
+
+    m_code = code;
+    m_slices.clear();
+    m_parts.clear();
+    m_doneSlices = 0;
+    m_inFlight = 0;
+    m_failed = false;
+
+    // 今天的K线盘中会变，覆盖区间最多记到昨天，保证下次仍会补今天
+    const QDate lastClosed = QDate::currentDate().addDays(-1);
+    BarCoverage cov;
+    const bool hasCoverage = BarStore::instance().coverage(code, &cov);
+    m_market = hasCoverage ? cov.market : -1;
+    m_markets = marketsForCode(code);
+
+    // 缺口：[from, cov.from) 与 (cov.to, to]；保持覆盖区间连续
+    QVector<Slice> gaps;
+    if (!hasCoverage) {
+        gaps.push_back({from, to});
+    } else {
+        if (from < cov.from) gaps.push_back({from, cov.from.addDays(-1)});
+        if (to > cov.to) gaps.push_back({cov.to.addDays(1), to});
+    }
+    m_coverFrom = hasCoverage ? std::min(from, cov.from) : from;
+    m_coverTo = std::min(hasCoverage ? std::max(to, cov.to) : to, lastClosed);
+
+    for (const auto& g : gaps) {
+        for (QDate s = g.from; s <= g.to; s = s.addDays(sliceDays)) {
+            m_slices.enqueue({s, std::min(g.to, s.addDays(sliceDays - 1))});
+        }
+    }
+    m_totalSlices = m_slices.size();
+
+    if (m_slices.isEmpty()) {
+        // 完全命中本地数据
+        complete(true, QString());
+        return;
+    }
+
+    emit progress(m_code, 0, m_totalSlices);
+    if (m_market >= 0) pumpSlices();
+    else probeMarket(0);
+}
+
+void BarFetcher::cancel()
+{
+    ++m_generation;     // 在途回调按代号丢弃
+    for (quint64 ticket : m_tickets) KlineHub::instance().cancel(ticket);
+    m_tickets.clear();
+    m_slices.clear();
+    m_inFlight = 0;
+}
+
+// 先用最新一片确定 market（secid 前缀），其余切片再并发
+void BarFetcher::probeMarket(int marketIndex)
+{
+    if (marketIndex >= m_markets.size()) {
+        complete(false, QString("无法获取 %1 的K线数据，请检查代码是否正确。").arg(m_code));
+        return;
+    }
+    const Slice slice = m_slices.last();
+    sendSlice(slice, m_markets[marketIndex], marketIndex);
+}
+
+void BarFetcher::pumpSlices()
+{
+    while (m_inFlight < maxInFlight && !m_slices.isEmpty()) {
+        sendSlice(m_slices.dequeue(), m_market, -1);
+    }
+}
+
+void BarFetcher::sendSlice(const Slice& slice, int market, int marketIndex)
+{
+    KlineRequest req;
+    req.baseUrl = kKlineUrl;
+    req.secid = QString("%1.%2").arg(market).arg(m_code);
+    req.from = slice.from;
+    req.to = slice.to;
+    req.ohlcv = true;
+    req.timeoutMs = timeoutMs;
+    ++m_inFlight;
+
+    const quint64 generation = m_generation;
+    const quint64 ticket = KlineHub::instance().fetch(req, this,
+        [this, slice, market, marketIndex, generation](quint64 ticket, const KlineResult& res) {
+        m_tickets.removeOne(ticket);
+        if (generation != m_generation) return;
+        if (m_inFlight > 0) --m_inFlight;
+
+        // 共用的响应可能比本片宽，多出的日期在 BarStore 合并时按日期去重
+        DailyBars part;
+        const bool ok = res.ok && parseBars(res.body, &part);
+
+        if (marketIndex >= 0) {
+            // 探测阶段：失败换下一个 market
+            if (!ok) {
+                probeMarket(marketIndex + 1);
+                return;
+            }
+            m_market = market;
+            m_slices.removeLast();
+        } else if (!ok) {
+            m_failed = true;
+        }
+
+        if (ok) m_parts.push_back(part);
+        ++m_doneSlices;
+        emit progress(m_code, m_doneSlices, m_totalSlices);
+
+        if (m_slices.isEmpty() && m_inFlight == 0) {
+            complete(!m_failed, m_failed ? QString("%1 部分区间拉取失败。").arg(m_code) : QString());
+            return;
+        }
+        pumpSlices();
+    });
+    m_tickets.append(ticket);
+}
+
+void BarFetcher::complete(bool ok, const QString& error)
+{
+    // 拉到的部分总是入库；只有全部切片成功才扩展覆盖区间
+    DailyBars all;
+    for (const auto& p : m_parts) {
+        all.dates += p.dates;
+        all.opens += p.opens;
+        all.closes += p.closes;
+        all.highs += p.highs;
+        all.lows += p.lows;
+        all.volumes += p.volumes;
+    }
+    if (m_totalSlices > 0 && (!all.isEmpty() || ok)) {
+        BarStore::instance().merge(m_code, all,
+                                   ok ? m_coverFrom : QDate(), ok ? m_coverTo : QDate(),
+                                   m_market);
+    }
+    m_parts.clear();
+    emit finished(m_code, ok, error);
+}
+
+bool BarFetcher::parseBars(const QByteArray& raw, DailyBars* out)
+{
+    auto doc = QJsonDocument::fromJson(raw);
+    if (!doc.isObject()) return false;
+    const auto dataVal = doc.object().value("data");
+    if (!dataVal.isObject()) return false;
+    const auto arr = dataVal.toObject().value("klines").toArray();
+    for (auto v : arr) {
+        const auto s = v.toString();
+        const auto parts = s.split(',');
+        if (parts.size() < 5) continue;
+        out->dates.push_back(QDate::fromString(parts[0], "yyyy-MM-dd"));
+        out->opens.push_back(parts[1].toDouble());
+        out->closes.push_back(parts[2].toDouble());
+        out->highs.push_back(parts[3].toDouble());
+        out->lows.push_back(parts[4].toDouble());
+        out->volumes.push_back(parts.size() > 5 ? parts[5].toDouble() : 0.0);
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "BarStore.h"
+
+#include <QObject>
+#include <QDate>
+#include <QList>
+#include <QQueue>
+#include <QVector>
+
+// 长区间日K线拉取：扣掉 BarStore 已覆盖的部分，剩余缺口按日期切片并发拉取，合并入库。
+// 请求经 KlineHub 发出，和扫描器 / 其它窗口对同一 secid 的在途请求共用结果
+class BarFetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BarFetcher(QObject* parent = nullptr);
+
+    void fetch(const QString& code, const QDate& from, const QDate& to);
+    void cancel();
+
+    static QList<int> marketsForCode(const QString& code);
+
+    int sliceDays = 300;        // 每片自然日跨度，约 200 根日K，远低于 lmt 上限
+    int maxInFlight = 6;
+    int timeoutMs = 12000;
+
+signals:
+    void progress(const QString& code, int doneSlices, int totalSlices);
+    void finished(const QString& code, bool ok, const QString& error);
+
+private:
+    struct Slice {
+        QDate from;
+        QDate to;
+    };
+
+    void probeMarket(int marketIndex);
+    void pumpSlices();
+    void sendSlice(const Slice& slice, int market, int marketIndex);
+    void complete(bool ok, const QString& error);
+
+    // data 为对象即视为 secid 有效（区间内无K线时 klines 为空数组）
+    static bool parseBars(const QByteArray& raw, DailyBars* out);
+
+    quint64 m_generation = 0;
+    QList<quint64> m_tickets;   // 在途的 KlineHub 票据，cancel 时撤回
+
+    QString m_code;
+    QDate m_coverFrom;
+    QDate m_coverTo;
+    int m_market = -1;
+    QList<int> m_markets;
+    QQueue<Slice> m_slices;
+    QVector<DailyBars> m_parts;
+    int m_totalSlices = 0;
+    int m_doneSlices = 0;
+    int m_inFlight = 0;
+    bool m_failed = false;
+};
@@ -0,0 +1,290 @@
+#include "BarStore.h"
+#include "MemoryUsage.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QReadLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QWriteLocker>
+
+#include <algorithm>
+
+BarStore& BarStore::instance()
+{
+    static BarStore store;
+    return store;
+}
+
+BarStore::BarStore()
+    : m_limit(MemoryUsage::limits().barStoreBytes)
+{
+}
+
+QString BarStore::dirPath() const
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/bars";
+    QDir().mkpath(dir);
+    return dir;
+}
+
+QString BarStore::filePath(const QString& code) const
+{
+    return dirPath() + "/" + code + ".json";
+}
+
+void BarStore::merge(const QString& code, const DailyBars& bars, const QDate& coveredFrom,
+                     const QDate& coveredTo, int market)
+{
+    if (code.isEmpty() || !bars.isConsistent()) return;
+    ensureLoaded(code);
+
+    QWriteLocker locker(&m_lock);
+    // 加载和上锁之间可能刚被裁剪掉：重新加载，免得拿残缺的数据覆盖磁盘
+    while (!m_diskChecked.contains(code)) {
+        locker.unlock();
+        ensureLoaded(code);
+        locker.relock();
+    }
+    Entry& e = m_entries[code];
+
+    // 按日期归并：旧数据先放，新数据覆盖同日；缺成交量的一侧按 0 补
+    struct Bar { double o, c, h, l, v; };
+    QMap<QDate, Bar> byDate;
+    auto collect = [&byDate](const DailyBars& src) {
+        const bool vol = src.hasVolume();
+        for (int i = 0; i < src.size(); ++i) {
+            if (!src.dates[i].isValid()) continue;
+            byDate.insert(src.dates[i], Bar{src.opens[i], src.closes[i], src.highs[i], src.lows[i],
+                                            vol ? src.volumes[i] : 0.0});
+        }
+    };
+    collect(e.bars);
+    collect(bars);
+    const bool withVolume = e.bars.hasVolume() || bars.hasVolume();
+
+    DailyBars merged;
+    merged.dates.reserve(byDate.size());
+    merged.opens.reserve(byDate.size());
+    merged.closes.reserve(byDate.size());
+    merged.highs.reserve(byDate.size());
+    merged.lows.reserve(byDate.size());
+    if (withVolume) merged.volumes.reserve(byDate.size());
+    for (auto it = byDate.cbegin(); it != byDate.cend(); ++it) {
+        merged.dates.push_back(it.key());
+        merged.opens.push_back(it->o);
+        merged.closes.push_back(it->c);
+        merged.highs.push_back(it->h);
+        merged.lows.push_back(it->l);
+        if (withVolume) merged.volumes.push_back(it->v);
+    }
+
+    // 只有内容真的变了才递增版本：重拉到相同的K线不会让推演缓存失效
+    if (merged.dates != e.bars.dates || merged.opens != e.bars.opens || merged.closes != e.bars.closes
+        || merged.highs != e.bars.highs || merged.lows != e.bars.lows || merged.volumes != e.bars.volumes) {
+        m_bytes += bytesOf(merged) - bytesOf(e.bars);
+        e.bars = merged;
+        ++e.version;
+    }
+    e.seq = ++m_seq;
+
+    if (coveredFrom.isValid() && coveredTo.isValid() && coveredFrom <= coveredTo) {
+        BarCoverage& cov = e.coverage;
+        if (!cov.from.isValid() || coveredFrom < cov.from) cov.from = coveredFrom;
+        if (!cov.to.isValid() || coveredTo > cov.to) cov.to = coveredTo;
+    }
+    if (market >= 0) e.coverage.market = market;
+    m_diskChecked.insert(code, true);
+
+    save(code, e);
+    trimLocked(code);
+}
+
+bool BarStore::get(const QString& code, DailyBars* out, quint64* version) const
+{
+    ensureLoaded(code);
+    QReadLocker locker(&m_lock);
+    while (!m_diskChecked.contains(code)) {
+        locker.unlock();
+        ensureLoaded(code);
+        locker.relock();
+    }
+    auto it = m_entries.constFind(code);
+    if (it == m_entries.constEnd() || it->bars.isEmpty()) return false;
+    if (out) *out = it->bars;
+    if (version) *version = it->version;
+    return true;
+}
+
+quint64 BarStore::version(const QString& code) const
+{
+    ensureLoaded(code);
+    QReadLocker locker(&m_lock);
+    auto it = m_entries.constFind(code);
+    return it == m_entries.constEnd() ? 0 : it->version;
+}
+
+bool BarStore::coverage(const QString& code, BarCoverage* out) const
+{
+    ensureLoaded(code);
+    QReadLocker locker(&m_lock);
+    auto it = m_entries.constFind(code);
+    if (it == m_entries.constEnd()) return false;
+    if (out) *out = it->coverage;
+    return it->coverage.from.isValid();
+}
+
+bool BarStore::contains(const QString& code) const
+{
+    return get(code, nullptr);
+}
+
+QStringList BarStore::codes() const
+{
+    QStringList out;
+    {
+        QReadLocker locker(&m_lock);
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            if (!it->bars.isEmpty()) out << it.key();
+        }
+    }
+    const QStringList files = QDir(dirPath()).entryList({"*.json"}, QDir::Files);
+    for (const auto& f : files) out << f.chopped(5);
+    out.removeDuplicates();
+    return out;
+}
+
+void BarStore::ensureLoaded(const QString& code) const
+{
+    {
+        QReadLocker locker(&m_lock);
+        if (m_diskChecked.contains(code)) return;
+    }
+
+    Entry e;
+    QFile f(filePath(code));
+    if (f.open(QIODevice::ReadOnly)) {
+        const auto doc = QJsonDocument::fromJson(f.readAll());
+        f.close();
+        const auto root = doc.object();
+        e.coverage.from = QDate::fromString(root.value("from").toString(), Qt::ISODate);
+        e.coverage.to = QDate::fromString(root.value("to").toString(), Qt::ISODate);
+        e.coverage.market = root.value("market").toInt(-1);
+        e.version = root.value("v").toVariant().toULongLong();
+        const auto jd = root.value("d").toArray();
+        const auto jo = root.value("o").toArray();
+        const auto jc = root.value("c").toArray();
+        const auto jh = root.value("h").toArray();
+        const auto jl = root.value("l").toArray();
+        const auto jv = root.value("vol").toArray();
+        const int n = jd.size();
+        if (jo.size() == n && jc.size() == n && jh.size() == n && jl.size() == n) {
+            e.bars.dates.reserve(n);
+            e.bars.opens.reserve(n);
+            e.bars.closes.reserve(n);
+            e.bars.highs.reserve(n);
+            e.bars.lows.reserve(n);
+            for (int i = 0; i < n; ++i) {
+                e.bars.dates.push_back(QDate::fromString(jd[i].toString(), Qt::ISODate));
+                e.bars.opens.push_back(jo[i].toDouble());
+                e.bars.closes.push_back(jc[i].toDouble());
+                e.bars.highs.push_back(jh[i].toDouble());
+                e.bars.lows.push_back(jl[i].toDouble());
+            }
+            if (jv.size() == n) {
+                e.bars.volumes.reserve(n);
+                for (int i = 0; i < n; ++i) e.bars.volumes.push_back(jv[i].toDouble());
+            }
+        } else {
+            e.coverage = BarCoverage{};
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    if (m_diskChecked.contains(code)) return;   // 别的线程已加载
+    m_diskChecked.insert(code, true);
+    if (!e.bars.isEmpty()) {
+        e.seq = ++m_seq;
+        m_bytes += bytesOf(e.bars);
+        m_entries.insert(code, e);
+        trimLocked(code);
+    }
+}
+
+qint64 BarStore::bytesOf(const DailyBars& bars)
+{
+    return MemoryUsage::ofVector(bars.dates) + MemoryUsage::ofVector(bars.opens)
+        + MemoryUsage::ofVector(bars.closes) + MemoryUsage::ofVector(bars.highs)
+        + MemoryUsage::ofVector(bars.lows) + MemoryUsage::ofVector(bars.volumes);
+}
+
+qint64 BarStore::memoryBytes() const
+{
+    QReadLocker locker(&m_lock);
+    return m_bytes + MemoryUsage::hashOverhead(m_entries.size() + m_diskChecked.size())
+        + qint64(m_entries.size()) * qint64(sizeof(Entry));
+}
+
+void BarStore::trimTo(qint64 bytes)
+{
+    QWriteLocker locker(&m_lock);
+    m_limit = bytes;
+    trimLocked(QString());
+}
+
+// 调用方持写锁。只丢内存副本：merge 总是同步落盘，去掉 m_diskChecked 标记后下次访问会重新加载
+void BarStore::trimLocked(const QString& keep) const
+{
+    if (m_limit <= 0 || m_bytes <= m_limit) return;
+
+    QVector<QPair<quint64, QString>> order;
+    order.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        if (it.key() != keep) order.push_back({it->seq, it.key()});
+    }
+    std::sort(order.begin(), order.end());
+
+    const qint64 target = m_limit / 10 * 9;
+    for (const auto& [seq, code] : order) {
+        if (m_bytes <= target) break;
+        auto it = m_entries.find(code);
+        m_bytes -= bytesOf(it->bars);
+        m_entries.erase(it);
+        m_diskChecked.remove(code);
+    }
+}
+
+void BarStore::save(const QString& code, const Entry& e) const
+{
+    QJsonArray jd, jo, jc, jh, jl, jv;
+    const bool vol = e.bars.hasVolume();
+    for (int i = 0; i < e.bars.size(); ++i) {
+        jd.append(e.bars.dates[i].toString(Qt::ISODate));
+        jo.append(e.bars.opens[i]);
+        jc.append(e.bars.closes[i]);
+        jh.append(e.bars.highs[i]);
+        jl.append(e.bars.lows[i]);
+        if (vol) jv.append(e.bars.volumes[i]);
+    }
+
+    QJsonObject root;
+    root.insert("from", e.coverage.from.toString(Qt::ISODate));
+    root.insert("to", e.coverage.to.toString(Qt::ISODate));
+    root.insert("market", e.coverage.market);
+    root.insert("v", double(e.version));
+    root.insert("d", jd);
+    root.insert("o", jo);
+    root.insert("c", jc);
+    root.insert("h", jh);
+    root.insert("l", jl);
+    if (vol) root.insert("vol", jv);
+
+    QSaveFile f(filePath(code));
+    if (!f.open(QIODevice::WriteOnly)) return;
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    f.commit();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QDate>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 日K线（前复权关闭，与推演请求一致）
+struct DailyBars {
+    QVector<QDate> dates;
+    QVector<double> opens;
+    QVector<double> closes;
+    QVector<double> highs;
+    QVector<double> lows;
+    QVector<double> volumes;    // 成交量（手）；旧缓存没有这一列时为空
+
+    int size() const { return closes.size(); }
+    bool isEmpty() const { return closes.isEmpty(); }
+    bool hasVolume() const { return !volumes.isEmpty(); }
+    bool isConsistent() const {
+        return dates.size() == closes.size() && opens.size() == closes.size()
+            && highs.size() == closes.size() && lows.size() == closes.size()
+            && (volumes.isEmpty() || volumes.size() == closes.size());
+    }
+};
+
+// 已完整拉取过的连续日期区间；区间内的请求直接用本地数据
+struct BarCoverage {
+    QDate from;
+    QDate to;
+    int market = -1;    // 拉取成功时用的 market（secid 前缀）
+};
+
+// 进程内共享的 K 线仓库：推演 / 图表等消费者都从这里读，读多写少。
+// 每只股票落盘为 AppData/bars/<code>.json，首次访问时懒加载；
+// 内存超过软上限时按载入先后丢掉最早的条目（磁盘上总是最新的，下次访问重新加载）
+class BarStore
+{
+public:
+    static BarStore& instance();
+
+    // 按日期合并新拉到的K线（同日以新数据为准），coveredFrom/To 有效时扩展覆盖区间并落盘
+    void merge(const QString& code, const DailyBars& bars, const QDate& coveredFrom,
+               const QDate& coveredTo, int market);
+    // version 随该股票K线内容变化递增（持久化），用于让依赖这份数据的缓存失效
+    bool get(const QString& code, DailyBars* out, quint64* version = nullptr) const;
+    quint64 version(const QString& code) const;
+    bool coverage(const QString& code, BarCoverage* out) const;
+    bool contains(const QString& code) const;
+    QStringList codes() const;
+
+    // 内存中K线的估算字节数
+    qint64 memoryBytes() const;
+    // 设置软上限（字节，0 = 不限）并立即裁剪到上限的 90%
+    void trimTo(qint64 bytes);
+
+private:
+    BarStore();
+
+    struct Entry {
+        DailyBars bars;
+        BarCoverage coverage;
+        quint64 version = 0;
+        quint64 seq = 0;        // 载入 / 写入序号，裁剪时先丢小的
+    };
+
+    static qint64 bytesOf(const DailyBars& bars);
+    void trimLocked(const QString& keep) const;
+
+    QString dirPath() const;
+    QString filePath(const QString& code) const;
+    void ensureLoaded(const QString& code) const;
+    void save(const QString& code, const Entry& entry) const;
+
+    mutable QReadWriteLock m_lock;
+    mutable QHash<QString, Entry> m_entries;
+    mutable QHash<QString, bool> m_diskChecked;
+    mutable qint64 m_bytes = 0;
+    mutable quint64 m_seq = 0;
+    qint64 m_limit = 0;
+};
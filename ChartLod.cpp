@@ -0,0 +1,113 @@
+#include "ChartLod.h"
+
+#include <QString>
+#include <algorithm>
+#include <cmath>
+
+ChartLod::Period ChartLod::choosePeriod(int bars, int pixels, int minPixelsPerCandle)
+{
+    const int capacity = std::max(1, pixels / std::max(1, minPixelsPerCandle));
+    if (bars <= capacity) return Period::Day;
+    if (bars / 5 <= capacity) return Period::Week;
+    return Period::Month;
+}
+
+QString ChartLod::periodName(Period period)
+{
+    switch (period) {
+    case Period::Week: return "周线";
+    case Period::Month: return "月线";
+    default: return "日线";
+    }
+}
+
+QVector<ChartLod::Candle> ChartLod::aggregate(const QVector<QDate>& dates, const QVector<qint64>& stamps,
+                                              const QVector<double>& opens, const QVector<double>& highs,
+                                              const QVector<double>& lows, const QVector<double>& closes,
+                                              int from, int to, Period period)
+{
+    QVector<Candle> out;
+    if (from < 0 || to < from) return out;
+    out.reserve(period == Period::Day ? (to - from + 1) : (to - from + 1) / 4 + 2);
+
+    auto bucketOf = [&](const QDate& d) -> int {
+        switch (period) {
+        case Period::Week: {
+            int year = 0;
+            const int week = d.weekNumber(&year);
+            return year * 100 + week;
+        }
+        case Period::Month: return d.year() * 100 + d.month();
+        default: return d.toJulianDay();
+        }
+    };
+
+    int currentBucket = -1;
+    for (int i = from; i <= to; ++i) {
+        if (!dates[i].isValid()) continue;
+        const int bucket = bucketOf(dates[i]);
+        if (out.isEmpty() || bucket != currentBucket) {
+            Candle c;
+            c.ts = stamps[i];
+            c.open = opens[i];
+            c.high = highs[i];
+            c.low = lows[i];
+            c.close = closes[i];
+            out.push_back(c);
+            currentBucket = bucket;
+            continue;
+        }
+        Candle& c = out.back();
+        c.high = std::max(c.high, highs[i]);
+        c.low = std::min(c.low, lows[i]);
+        c.close = closes[i];
+    }
+    return out;
+}
+
+QVector<QPointF> ChartLod::lttb(const QVector<QPointF>& data, int threshold)
+{
+    const int n = data.size();
+    if (threshold >= n || threshold < 3) return data;
+
+    QVector<QPointF> out;
+    out.reserve(threshold);
+    out.push_back(data.first());
+
+    // 首尾固定，中间 n-2 个点分成 threshold-2 个桶，每桶选与前一选中点、下一桶均值构成三角形面积最大的点
+    const double every = double(n - 2) / (threshold - 2);
+    int a = 0;
+    for (int i = 0; i < threshold - 2; ++i) {
+        int avgStart = int(std::floor((i + 1) * every)) + 1;
+        int avgEnd = std::min(int(std::floor((i + 2) * every)) + 1, n);
+        double avgX = 0;
+        double avgY = 0;
+        const int avgLen = std::max(1, avgEnd - avgStart);
+        for (int j = avgStart; j < avgEnd; ++j) {
+            avgX += data[j].x();
+            avgY += data[j].y();
+        }
+        avgX /= avgLen;
+        avgY /= avgLen;
+
+        const int rangeStart = int(std::floor(i * every)) + 1;
+        const int rangeEnd = int(std::floor((i + 1) * every)) + 1;
+        const double ax = data[a].x();
+        const double ay = data[a].y();
+
+        double maxArea = -1;
+        int chosen = rangeStart;
+        for (int j = rangeStart; j < rangeEnd; ++j) {
+            const double area = std::abs((ax - avgX) * (data[j].y() - ay) - (ax - data[j].x()) * (avgY - ay));
+            if (area > maxArea) {
+                maxArea = area;
+                chosen = j;
+            }
+        }
+        out.push_back(data[chosen]);
+        a = chosen;
+    }
+
+    out.push_back(data.last());
+    return out;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QDate>
+#include <QPointF>
+#include <QVector>
+
+// 长区间K线图的细节层级：K 线根数多于像素时聚合成周/月线，均线用 LTTB 抽稀
+class ChartLod
+{
+public:
+    enum class Period { Day, Week, Month };
+
+    struct Candle {
+        qint64 ts = 0;              // 该周期第一根日K线的时间戳
+        double open = 0;
+        double high = 0;
+        double low = 0;
+        double close = 0;
+    };
+
+    // 每根蜡烛至少占 minPixelsPerCandle 像素，放不下就降一级
+    static Period choosePeriod(int bars, int pixels, int minPixelsPerCandle = 3);
+    static QString periodName(Period period);
+
+    static QVector<Candle> aggregate(const QVector<QDate>& dates, const QVector<qint64>& stamps,
+                                     const QVector<double>& opens, const QVector<double>& highs,
+                                     const QVector<double>& lows, const QVector<double>& closes,
+                                     int from, int to, Period period);
+
+    // Largest-Triangle-Three-Buckets：保留峰谷形状，输出不超过 threshold 个点
+    static QVector<QPointF> lttb(const QVector<QPointF>& data, int threshold);
+};
@@ -0,0 +1,268 @@
+#include "KlineChartWidget.h"
+#include "BacktestEngine.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+const QColor kBackground("#101014");
+const QColor kGrid("#26262e");
+const QColor kText("#b0b0b8");
+const QColor kUp("#e0443c");        // A股习惯：红涨绿跌
+const QColor kDown("#1fa35c");
+const QColor kMa5("#f0c040");
+const QColor kMa10("#40a0f0");
+const QColor kMa20("#c060e0");
+
+constexpr int kMarginLeft = 8;
+constexpr int kMarginRight = 64;    // 右侧价格刻度
+constexpr int kMarginTop = 22;      // 顶部信息栏
+constexpr int kMarginBottom = 20;   // 底部日期
+constexpr int kPanelGap = 8;
+constexpr int kMinVisible = 20;
+}
+
+KlineChartWidget::KlineChartWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    setMouseTracking(true);
+    setAutoFillBackground(false);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void KlineChartWidget::setBars(const DailyBars& bars)
+{
+    // 刷新数据时如果原来贴着最右边，继续贴着；否则保持用户平移的位置
+    const bool followTail = m_last < 0 || m_last >= m_bars.size() - 1;
+    m_bars = bars;
+    m_ma5 = BacktestEngine::movingAverage(bars.closes, 5);
+    m_ma10 = BacktestEngine::movingAverage(bars.closes, 10);
+    m_ma20 = BacktestEngine::movingAverage(bars.closes, 20);
+    m_message.clear();
+    if (followTail) m_last = m_bars.size() - 1;
+    m_hover = -1;
+    clampView();
+    update();
+}
+
+void KlineChartWidget::setMessage(const QString& text)
+{
+    m_message = text;
+    update();
+}
+
+void KlineChartWidget::clampView()
+{
+    const int n = m_bars.size();
+    m_visible = std::max(kMinVisible, std::min(m_visible, std::max(n, kMinVisible)));
+    if (n == 0) {
+        m_last = -1;
+        return;
+    }
+    m_last = std::max(std::min(m_last, n - 1), std::min(n, m_visible) - 1);
+}
+
+KlineChartWidget::Layout KlineChartWidget::layoutFor(const QRect& area) const
+{
+    Layout lay;
+    const QRectF plot(area.left() + kMarginLeft, area.top() + kMarginTop,
+                      area.width() - kMarginLeft - kMarginRight,
+                      area.height() - kMarginTop - kMarginBottom);
+    const double volH = m_bars.hasVolume() ? plot.height() * 0.22 : 0;
+    lay.price = QRectF(plot.left(), plot.top(), plot.width(),
+                       plot.height() - volH - (volH > 0 ? kPanelGap : 0));
+    lay.volume = QRectF(plot.left(), plot.bottom() - volH, plot.width(), volH);
+    lay.barWidth = plot.width() / std::max(1, m_visible);
+    return lay;
+}
+
+int KlineChartWidget::indexAt(double x, const Layout& lay) const
+{
+    if (m_bars.isEmpty() || x < lay.price.left() || x > lay.price.right()) return -1;
+    const int first = m_last - m_visible + 1;
+    const int i = first + int((x - lay.price.left()) / lay.barWidth);
+    return (i >= 0 && i <= m_last) ? i : -1;
+}
+
+void KlineChartWidget::paintEvent(QPaintEvent*)
+{
+    QPainter p(this);
+    p.fillRect(rect(), kBackground);
+    p.setPen(kText);
+
+    if (m_bars.isEmpty()) {
+        p.drawText(rect(), Qt::AlignCenter, m_message.isEmpty() ? QString("暂无本地K线数据") : m_message);
+        return;
+    }
+
+    const Layout lay = layoutFor(rect());
+    const int first = std::max(0, m_last - m_visible + 1);
+    const double bw = lay.barWidth;
+    auto xOf = [&](int i) { return lay.price.left() + (i - (m_last - m_visible + 1) + 0.5) * bw; };
+
+    // 可见区间的价格 / 成交量范围
+    double lo = std::numeric_limits<double>::max();
+    double hi = std::numeric_limits<double>::lowest();
+    double volMax = 0;
+    for (int i = first; i <= m_last; ++i) {
+        lo = std::min(lo, m_bars.lows[i]);
+        hi = std::max(hi, m_bars.highs[i]);
+        for (const auto* ma : {&m_ma5, &m_ma10, &m_ma20}) {
+            const double v = (*ma)[i];
+            if (std::isfinite(v)) { lo = std::min(lo, v); hi = std::max(hi, v); }
+        }
+        if (m_bars.hasVolume()) volMax = std::max(volMax, m_bars.volumes[i]);
+    }
+    if (hi <= lo) { hi = lo + 1; }
+    const double pad = (hi - lo) * 0.05;
+    lo -= pad;
+    hi += pad;
+    auto yOf = [&](double v) { return lay.price.bottom() - (v - lo) / (hi - lo) * lay.price.height(); };
+
+    // 网格与右侧刻度
+    const QFontMetrics fm(font());
+    for (int k = 0; k <= 4; ++k) {
+        const double v = lo + (hi - lo) * k / 4.0;
+        const double y = yOf(v);
+        p.setPen(kGrid);
+        p.drawLine(QPointF(lay.price.left(), y), QPointF(lay.price.right(), y));
+        p.setPen(kText);
+        p.drawText(QPointF(lay.price.right() + 6, y + fm.ascent() / 2.0), QString::number(v, 'f', 2));
+    }
+
+    // 底部日期：大约每 100 像素一个
+    const int step = std::max(1, int(std::ceil(100.0 / bw)));
+    for (int i = first; i <= m_last; i += step) {
+        const double x = xOf(i);
+        p.setPen(kGrid);
+        p.drawLine(QPointF(x, lay.price.top()), QPointF(x, lay.volume.bottom()));
+        p.setPen(kText);
+        const QString d = m_bars.dates[i].toString("yyyy-MM-dd");
+        p.drawText(QPointF(x - fm.horizontalAdvance(d) / 2.0, height() - 5), d);
+    }
+
+    // 蜡烛与成交量
+    const double body = std::max(1.0, bw * 0.7);
+    for (int i = first; i <= m_last; ++i) {
+        const double o = m_bars.opens[i];
+        const double c = m_bars.closes[i];
+        const QColor col = (c >= o) ? kUp : kDown;
+        const double x = xOf(i);
+        p.setPen(col);
+        p.drawLine(QPointF(x, yOf(m_bars.highs[i])), QPointF(x, yOf(m_bars.lows[i])));
+        const double top = yOf(std::max(o, c));
+        const double h = std::max(1.0, yOf(std::min(o, c)) - top);
+        p.fillRect(QRectF(x - body / 2, top, body, h), col);
+
+        if (volMax > 0) {
+            const double vh = m_bars.volumes[i] / volMax * lay.volume.height();
+            p.fillRect(QRectF(x - body / 2, lay.volume.bottom() - vh, body, vh), col);
+        }
+    }
+
+    // 均线：NaN 处断开
+    p.setRenderHint(QPainter::Antialiasing, true);
+    auto drawMa = [&](const QVector<double>& ma, const QColor& color) {
+        QPainterPath path;
+        bool pen = false;
+        for (int i = first; i <= m_last; ++i) {
+            if (!std::isfinite(ma[i])) { pen = false; continue; }
+            const QPointF pt(xOf(i), yOf(ma[i]));
+            if (pen) path.lineTo(pt);
+            else path.moveTo(pt);
+            pen = true;
+        }
+        p.setPen(QPen(color, 1.2));
+        p.drawPath(path);
+    };
+    drawMa(m_ma20, kMa20);
+    drawMa(m_ma10, kMa10);
+    drawMa(m_ma5, kMa5);
+    p.setRenderHint(QPainter::Antialiasing, false);
+
+    // 顶部信息：悬停的K线，否则最新一根
+    const int i = (m_hover >= first && m_hover <= m_last) ? m_hover : m_last;
+    if (m_hover == i) {
+        p.setPen(QPen(kText, 1, Qt::DashLine));
+        p.drawLine(QPointF(xOf(i), lay.price.top()), QPointF(xOf(i), lay.volume.bottom()));
+    }
+    const double prev = i > 0 ? m_bars.closes[i - 1] : m_bars.opens[i];
+    const double chg = prev > 0 ? (m_bars.closes[i] / prev - 1.0) * 100.0 : 0.0;
+    auto maText = [](const QVector<double>& ma, int idx) {
+        return std::isfinite(ma[idx]) ? QString::number(ma[idx], 'f', 2) : QString("-");
+    };
+    QString info = QString("%1  开 %2  高 %3  低 %4  收 %5  %6%7%")
+                       .arg(m_bars.dates[i].toString("yyyy-MM-dd"))
+                       .arg(m_bars.opens[i], 0, 'f', 2)
+                       .arg(m_bars.highs[i], 0, 'f', 2)
+                       .arg(m_bars.lows[i], 0, 'f', 2)
+                       .arg(m_bars.closes[i], 0, 'f', 2)
+                       .arg(chg >= 0 ? "+" : "")
+                       .arg(chg, 0, 'f', 2);
+    if (m_bars.hasVolume()) info += QString("  量 %1").arg(m_bars.volumes[i], 0, 'f', 0);
+    p.setPen(kText);
+    p.drawText(QPointF(kMarginLeft, fm.ascent() + 3), info);
+
+    const QString maInfo = QString("MA5 %1  MA10 %2  MA20 %3")
+                               .arg(maText(m_ma5, i), maText(m_ma10, i), maText(m_ma20, i));
+    const double mx = width() - kMarginRight - fm.horizontalAdvance(maInfo);
+    p.drawText(QPointF(mx, fm.ascent() + 3), maInfo);
+}
+
+void KlineChartWidget::wheelEvent(QWheelEvent* event)
+{
+    if (m_bars.isEmpty()) return;
+    const Layout lay = layoutFor(rect());
+    const double x = event->position().x();
+    const int anchor = indexAt(x, lay);
+    const double ratio = (x - lay.price.left()) / std::max(1.0, lay.price.width());
+
+    // 以鼠标下的K线为中心缩放
+    const double factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    m_visible = int(std::round(m_visible * factor));
+    clampView();
+    if (anchor >= 0) {
+        const int firstNew = anchor - int(ratio * m_visible);
+        m_last = firstNew + m_visible - 1;
+        clampView();
+    }
+    update();
+    event->accept();
+}
+
+void KlineChartWidget::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = true;
+        m_dragStartX = event->localPos().x();
+        m_dragStartLast = m_last;
+    }
+}
+
+void KlineChartWidget::mouseMoveEvent(QMouseEvent* event)
+{
+    const Layout lay = layoutFor(rect());
+    if (m_dragging) {
+        const int shift = int((event->localPos().x() - m_dragStartX) / std::max(1.0, lay.barWidth));
+        m_last = m_dragStartLast - shift;
+        clampView();
+    }
+    m_hover = indexAt(event->localPos().x(), lay);
+    update();
+}
+
+void KlineChartWidget::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) m_dragging = false;
+}
+
+void KlineChartWidget::leaveEvent(QEvent*)
+{
+    m_hover = -1;
+    update();
+}
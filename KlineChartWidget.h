@@ -0,0 +1,53 @@
+#pragma once
+
+#include "BarStore.h"
+
+#include <QWidget>
+#include <QVector>
+
+// 本地日K图：QPainter 直接画蜡烛、均线和成交量，不依赖网络和 WebEngine。
+// 滚轮缩放、左键拖动平移，鼠标所在K线的 OHLC 显示在顶部
+class KlineChartWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit KlineChartWidget(QWidget* parent = nullptr);
+
+    void setBars(const DailyBars& bars);
+    bool hasBars() const { return !m_bars.isEmpty(); }
+    void setMessage(const QString& text);
+
+    QSize sizeHint() const override { return QSize(900, 560); }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void leaveEvent(QEvent* event) override;
+
+private:
+    struct Layout {
+        QRectF price;
+        QRectF volume;
+        double barWidth = 0;
+    };
+
+    Layout layoutFor(const QRect& area) const;
+    void clampView();
+    int indexAt(double x, const Layout& lay) const;
+
+    DailyBars m_bars;
+    QVector<double> m_ma5;
+    QVector<double> m_ma10;
+    QVector<double> m_ma20;
+    QString m_message;
+
+    int m_visible = 120;    // 可见K线根数
+    int m_last = -1;        // 最右一根的下标
+    int m_hover = -1;
+    bool m_dragging = false;
+    double m_dragStartX = 0;
+    int m_dragStartLast = -1;
+};
@@ -1,27 +1,105 @@
 ﻿#include "KlineDialog.h"
 
+#include "KlineChartWidget.h"
+#include "BarFetcher.h"
+#include "BarStore.h"
+#include "TradingViewPool.h"
+
 #include <QVBoxLayout>
+#include <QHBoxLayout>
 #include <QLabel>
+#include <QComboBox>
+#include <QStackedWidget>
+#include <QSettings>
+#include <QStandardPaths>
 #include <QtWebEngineWidgets/QWebEngineView>
-#include <QtWebEngineCore/QWebEngineSettings>
+
+namespace {
+static const char* kModeKey = "kline/mode";
+
+// 与其它本地数据放在一起，不依赖组织名
+static QString settingsPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/settings.ini";
+}
+}
 
 KlineDialog::KlineDialog(const QString& code, int market, const QString& name, QWidget* parent)
     : QDialog(parent)
+    , m_code(code.trimmed())
+    , m_market(market)
 {
     setWindowTitle(QString("%1 %2").arg(code, name));
     resize(1100, 720);
 
     auto* layout = new QVBoxLayout(this);
+    auto* header = new QHBoxLayout();
     m_titleLabel = new QLabel(this);
     m_titleLabel->setText(QString("K线 & 指标：%1 %2").arg(code, name));
-    layout->addWidget(m_titleLabel);
+    header->addWidget(m_titleLabel, 1);
+    m_modeCombo = new QComboBox(this);
+    m_modeCombo->addItems({"本地图表", "TradingView"});
+    header->addWidget(m_modeCombo);
+    layout->addLayout(header);
 
-    m_view = new QWebEngineView(this);
-    m_view->settings()->setAttribute(QWebEngineSettings::JavascriptEnabled, true);
-    layout->addWidget(m_view, 1);
+    m_stack = new QStackedWidget(this);
+    m_chart = new KlineChartWidget(m_stack);
+    m_stack->addWidget(m_chart);
+    layout->addWidget(m_stack, 1);
 
-    const QString symbol = toTradingViewSymbol(code.trimmed(), market);
-    loadChart(symbol);
+    connect(m_modeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        QSettings(settingsPath(), QSettings::IniFormat).setValue(kModeKey, index);
+        if (index == 0) showNative();
+        else showTradingView();
+    });
+    if (prefersTradingView()) m_modeCombo->setCurrentIndex(1);
+    else showNative();
+}
+
+KlineDialog::~KlineDialog()
+{
+    // 视图归还给池子，不能随对话框一起删掉
+    if (m_view) {
+        m_stack->removeWidget(m_view);
+        TradingViewPool::instance().release(m_view);
+        m_view = nullptr;
+    }
+}
+
+bool KlineDialog::prefersTradingView()
+{
+    return QSettings(settingsPath(), QSettings::IniFormat).value(kModeKey, 0).toInt() == 1;
+}
+
+void KlineDialog::showNative()
+{
+    m_stack->setCurrentWidget(m_chart);
+
+    // 先画本地已有的，再补缺口（通常只差今天一根），离线时保持本地数据
+    DailyBars bars;
+    if (BarStore::instance().get(m_code, &bars)) m_chart->setBars(bars);
+    else m_chart->setMessage("正在拉取K线...");
+
+    if (!m_fetcher) {
+        m_fetcher = new BarFetcher(this);
+        connect(m_fetcher, &BarFetcher::finished, this, [this](const QString& code, bool, const QString& error) {
+            DailyBars latest;
+            if (BarStore::instance().get(code, &latest)) m_chart->setBars(latest);
+            else m_chart->setMessage(error.isEmpty() ? QString("暂无本地K线数据") : error);
+        });
+    }
+    const QDate today = QDate::currentDate();
+    m_fetcher->fetch(m_code, today.addYears(-2), today);
+}
+
+void KlineDialog::showTradingView()
+{
+    if (!m_view) {
+        m_view = TradingViewPool::instance().acquire(m_stack);
+        m_stack->addWidget(m_view);
+        TradingViewPool::instance().showSymbol(m_view, toTradingViewSymbol(m_code, m_market));
+    }
+    m_stack->setCurrentWidget(m_view);
 }
 
 QString KlineDialog::toTradingViewSymbol(const QString& code, int market) const
@@ -36,46 +114,3 @@ QString KlineDialog::toTradingViewSymbol(const QString& code, int market) const
     }
     return QString("SZSE:%1").arg(code);
 }
-
-void KlineDialog::loadChart(const QString& symbol)
-{
-    const QString html = QString(R"(
-<!DOCTYPE html>
-<html>
-<head>
-  <meta charset="utf-8">
-  <style>
-    html, body, #tv_container { margin: 0; width: 100%%; height: 100%%; background: #101014; }
-  </style>
-</head>
-<body>
-  <div id="tv_container"></div>
-  <script src="https://s3.tradingview.com/tv.js"></script>
-  <script>
-    new TradingView.widget({
-      "autosize": true,
-      "symbol": "%1",
-      "interval": "D",
-      "timezone": "Asia/Shanghai",
-      "theme": "dark",
-      "style": "1",
-      "locale": "zh_CN",
-      "toolbar_bg": "#101014",
-      "enable_publishing": false,
-      "allow_symbol_change": true,
-      "studies": ["MASimple@tv-basicstudies", "MACD@tv-basicstudies", "RSI@tv-basicstudies"],
-      "container_id": "tv_container",
-      "withdateranges": true,
-      "hide_side_toolbar": false,
-      "details": true,
-      "show_popup_button": true,
-      "popup_width": "1200",
-      "popup_height": "720"
-    });
-  </script>
-</body>
-</html>
-    )").arg(symbol);
-
-    m_view->setHtml(html, QUrl("https://s3.tradingview.com/"));
-}
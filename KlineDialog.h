@@ -4,17 +4,34 @@
 
 class QWebEngineView;
 class QLabel;
+class QComboBox;
+class QStackedWidget;
+class KlineChartWidget;
+class BarFetcher;
 
+// 默认用本地K线直接绘制（秒开、可离线）；TradingView 视图从共享池借用，关窗时归还
 class KlineDialog : public QDialog
 {
     Q_OBJECT
 public:
     explicit KlineDialog(const QString& code, int market, const QString& name, QWidget* parent = nullptr);
+    ~KlineDialog() override;
+
+    // 上次使用的是否是 TradingView；主窗口据此决定要不要预热视图池
+    static bool prefersTradingView();
 
 private:
     QString toTradingViewSymbol(const QString& code, int market) const;
-    void loadChart(const QString& symbol);
+    void showNative();
+    void showTradingView();
+
+    QString m_code;
+    int m_market = 0;
 
+    QComboBox* m_modeCombo = nullptr;
+    QStackedWidget* m_stack = nullptr;
+    KlineChartWidget* m_chart = nullptr;
+    BarFetcher* m_fetcher = nullptr;
     QWebEngineView* m_view = nullptr;
     QLabel* m_titleLabel = nullptr;
 };
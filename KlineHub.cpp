@@ -0,0 +1,273 @@
+#include "KlineHub.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QUrlQuery>
+#include <algorithm>
+#include <limits>
+
+namespace {
+static const char* kEM_UT = "fa5fd1943c7b386f172d6893dbfba10b";
+static const int kAllBars = 100000;         // 不限起点也不限根数：整段历史
+static const int kMaxMergedDays = 400;      // 合并后的区间上限：不把长区间切片重新拼成超过 lmt 上限的大请求
+
+static void FillCommonHeaders(QNetworkRequest& req) {
+    req.setRawHeader("User-Agent", "Mozilla/5.0");
+    req.setRawHeader("Accept", "application/json,text/plain,*/*");
+    req.setRawHeader("Accept-Language", "zh-CN,zh;q=0.9,en;q=0.8");
+    req.setRawHeader("Referer", "https://quote.eastmoney.com/");
+}
+
+static bool isFullHistory(const KlineRequest& r)
+{
+    return r.rawUrl.isEmpty() && !r.from.isValid() && r.tail <= 0;
+}
+
+// 实际请求的起点：按区间起点，若还要最近 tail 根则再往前放到 2×tail 个自然日（交易日约占 2/3）
+static QDate effectiveBegin(const KlineRequest& r)
+{
+    if (!r.from.isValid()) return QDate();
+    if (r.tail <= 0) return r.from;
+    return std::min(r.from, QDate::currentDate().addDays(-2 * r.tail));
+}
+
+// 请求跨越的自然日数，用于限制合并
+static int spanDays(const KlineRequest& r)
+{
+    if (isFullHistory(r)) return std::numeric_limits<int>::max();
+    const QDate begin = effectiveBegin(r);
+    if (!begin.isValid()) return 2 * r.tail;
+    return int(begin.daysTo(r.to.isValid() ? r.to : QDate::currentDate())) + 1;
+}
+}
+
+KlineHub& KlineHub::instance()
+{
+    static KlineHub* hub = new KlineHub;
+    return *hub;
+}
+
+KlineHub::KlineHub(QObject* parent)
+    : QObject(parent)
+{
+    m_nam = new QNetworkAccessManager(this);
+    m_dispatchTimer = new QTimer(this);
+    m_dispatchTimer->setSingleShot(true);
+    m_dispatchTimer->setInterval(0);
+    connect(m_dispatchTimer, &QTimer::timeout, this, &KlineHub::dispatch);
+}
+
+QString KlineHub::keyOf(const KlineRequest& req)
+{
+    if (!req.rawUrl.isEmpty()) return req.rawUrl.toString();
+    return req.baseUrl + "|" + req.secid;
+}
+
+bool KlineHub::covers(const KlineRequest& g, const KlineRequest& r)
+{
+    if (!r.rawUrl.isEmpty() || !g.rawUrl.isEmpty()) return r.rawUrl == g.rawUrl;
+    if (r.ohlcv && !g.ohlcv) return false;
+
+    // 终点：开放的只能由开放的覆盖
+    if (r.to.isValid()) {
+        if (g.to.isValid() && g.to < r.to) return false;
+    } else if (g.to.isValid()) {
+        return false;
+    }
+
+    if (isFullHistory(g)) return true;
+    if (isFullHistory(r)) return false;
+
+    const QDate gBegin = effectiveBegin(g);
+    if (r.from.isValid() && (!gBegin.isValid() || gBegin > r.from)) return false;
+    if (r.tail > 0 && g.tail < r.tail
+        && (!gBegin.isValid() || gBegin > QDate::currentDate().addDays(-2 * r.tail))) {
+        return false;
+    }
+    return true;
+}
+
+void KlineHub::widen(KlineRequest& g, const KlineRequest& r)
+{
+    g.ohlcv = g.ohlcv || r.ohlcv;
+    g.to = (g.to.isValid() && r.to.isValid()) ? std::max(g.to, r.to) : QDate();
+    g.timeoutMs = std::max(g.timeoutMs, r.timeoutMs);
+    if (isFullHistory(g) || isFullHistory(r)) {
+        g.from = QDate();
+        g.tail = 0;
+        return;
+    }
+    if (g.from.isValid() && r.from.isValid()) g.from = std::min(g.from, r.from);
+    else if (r.from.isValid()) g.from = r.from;
+    g.tail = std::max(g.tail, r.tail);
+}
+
+QUrl KlineHub::urlOf(const KlineRequest& spec)
+{
+    if (!spec.rawUrl.isEmpty()) return spec.rawUrl;
+
+    const QDate begin = effectiveBegin(spec);
+    const QDate end = spec.to.isValid() ? spec.to : QDate::currentDate();
+    int lmt = kAllBars;
+    if (begin.isValid()) lmt = std::max(spec.tail, int(begin.daysTo(end)) + 1);
+    else if (spec.tail > 0) lmt = spec.tail;
+
+    QUrl url(spec.baseUrl);
+    QUrlQuery q;
+    q.addQueryItem("secid", spec.secid);
+    q.addQueryItem("klt", "101");
+    q.addQueryItem("fqt", "0");
+    q.addQueryItem("beg", begin.isValid() ? begin.toString("yyyyMMdd") : QString("0"));
+    q.addQueryItem("end", spec.to.isValid() ? spec.to.toString("yyyyMMdd") : QString("20500101"));
+    q.addQueryItem("lmt", QString::number(lmt));
+    q.addQueryItem("rtntype", "6");
+    q.addQueryItem("ut", kEM_UT);
+    q.addQueryItem("fields1", "f1,f2,f3,f4");
+    q.addQueryItem("fields2", spec.ohlcv ? "f51,f52,f53,f54,f55,f56" : "f51,f52,f53");
+    url.setQuery(q);
+    return url;
+}
+
+quint64 KlineHub::fetch(const KlineRequest& req, QObject* context, Callback cb)
+{
+    ++m_requests;
+    const quint64 ticket = ++m_nextTicket;
+    Waiter w{ticket, context, std::move(cb)};
+    QList<Group*>& groups = m_groups[keyOf(req)];
+
+    // 已在途或待发的组覆盖了新请求：直接等它的结果
+    for (Group* g : groups) {
+        if (!covers(g->spec, req)) continue;
+        if (g->reply) ++m_attached;
+        else ++m_merged;
+        g->waiters.push_back(std::move(w));
+        m_byTicket.insert(ticket, g);
+        return ticket;
+    }
+    // 本轮还没发出的组：放宽区间并进去
+    if (req.rawUrl.isEmpty()) {
+        for (Group* g : groups) {
+            if (g->reply) continue;
+            KlineRequest merged = g->spec;
+            widen(merged, req);
+            if (spanDays(merged) > kMaxMergedDays) continue;
+            g->spec = merged;
+            ++m_merged;
+            g->waiters.push_back(std::move(w));
+            m_byTicket.insert(ticket, g);
+            return ticket;
+        }
+    }
+
+    auto* g = new Group;
+    g->key = keyOf(req);
+    g->spec = req;
+    g->waiters.push_back(std::move(w));
+    groups.push_back(g);
+    m_byTicket.insert(ticket, g);
+    m_pending.push_back(g);
+    if (!m_dispatchTimer->isActive()) m_dispatchTimer->start();
+    return ticket;
+}
+
+void KlineHub::cancel(quint64 ticket)
+{
+    Group* g = m_byTicket.take(ticket);
+    if (!g) return;
+    ++m_cancelled;
+    if (g->finishing) return;   // 分发中：票据已摘掉，轮到它时会跳过
+    for (int i = 0; i < g->waiters.size(); ++i) {
+        if (g->waiters[i].ticket == ticket) {
+            g->waiters.removeAt(i);
+            break;
+        }
+    }
+    if (g->waiters.isEmpty()) drop(g);
+}
+
+void KlineHub::dispatch()
+{
+    const QList<Group*> pending = m_pending;
+    m_pending.clear();
+    for (Group* g : pending) send(g);
+}
+
+void KlineHub::send(Group* g)
+{
+    QNetworkRequest req(urlOf(g->spec));
+    FillCommonHeaders(req);
+    auto* reply = m_nam->get(req);
+    g->reply = reply;
+    ++m_sent;
+
+    QTimer::singleShot(g->spec.timeoutMs, reply, [reply](){
+        if (reply && reply->isRunning()) reply->abort();
+    });
+    connect(reply, &QNetworkReply::downloadProgress, this, [this, g](qint64 received, qint64) {
+        emit bufferDelta(received - g->received);
+        g->received = received;
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, g]() { finish(g); });
+}
+
+void KlineHub::finish(Group* g)
+{
+    QNetworkReply* reply = g->reply;
+    KlineResult result;
+    result.body = reply->readAll();
+    result.ok = reply->error() == QNetworkReply::NoError;
+    result.error = reply->errorString();
+    result.host = reply->url().host();
+    result.waiters = g->waiters.size();
+    reply->deleteLater();
+
+    // 先摘掉：回调里重试同一 secid 会开新组
+    QList<Group*>& groups = m_groups[g->key];
+    groups.removeOne(g);
+    if (groups.isEmpty()) m_groups.remove(g->key);
+
+    g->finishing = true;
+    const QList<Waiter> waiters = g->waiters;
+    for (const auto& w : waiters) {
+        // 回调里可能撤回同组后面的等待者
+        if (!m_byTicket.remove(w.ticket)) continue;
+        if (w.context && w.cb) w.cb(w.ticket, result);
+    }
+    emit bufferDelta(-g->received);
+    delete g;
+}
+
+void KlineHub::drop(Group* g)
+{
+    QList<Group*>& groups = m_groups[g->key];
+    groups.removeOne(g);
+    if (groups.isEmpty()) m_groups.remove(g->key);
+    m_pending.removeOne(g);
+    if (g->reply) {
+        g->reply->disconnect(this);
+        g->reply->abort();
+        g->reply->deleteLater();
+        emit bufferDelta(-g->received);
+    }
+    delete g;
+}
+
+QJsonObject KlineHub::stats() const
+{
+    int inFlight = 0;
+    for (const auto& groups : m_groups) {
+        for (const Group* g : groups) {
+            if (g->reply) ++inFlight;
+        }
+    }
+    return QJsonObject{
+        {"requests", double(m_requests)},
+        {"sent", double(m_sent)},
+        {"attached", double(m_attached)},
+        {"merged", double(m_merged)},
+        {"cancelled", double(m_cancelled)},
+        {"inFlight", inFlight},
+    };
+}
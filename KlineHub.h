@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDate>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QUrl>
+
+#include <functional>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+// 日K线请求。东财按区间描述，同一 secid 的请求由 KlineHub 合并；
+// 其它源（新浪）给完整 URL，只有完全相同的 URL 才合并
+struct KlineRequest {
+    QString baseUrl;        // 东财 kline/get 地址
+    QString secid;
+    QDate from;             // 无效：不限起点
+    QDate to;               // 无效：到最新
+    int tail = 0;           // >0：至少要最近 tail 根
+    bool ohlcv = false;     // false 只要 日期/开/收（f51-f53），true 再加 高/低/量
+    QUrl rawUrl;            // 非空时按原样请求，忽略上面的区间字段
+    int timeoutMs = 12000;
+};
+
+struct KlineResult {
+    QByteArray body;
+    bool ok = false;        // 网络层成功；内容是否可用由调用方解析判断
+    QString error;
+    QString host;
+    int waiters = 1;        // 共享这次响应的请求数
+};
+
+// 进程内共享的K线请求层（single-flight）：同一 secid 已在途且区间覆盖新请求时直接挂上去等结果；
+// 同一轮事件循环里到达、尚未发出的请求合并成一条最宽的区间再发。
+// 扫描器、推演、图表以及多个扫描器实例都经由这里，不会对同一数据并行重复请求。
+// 只在主线程使用
+class KlineHub : public QObject
+{
+    Q_OBJECT
+public:
+    using Callback = std::function<void(quint64 ticket, const KlineResult& result)>;
+
+    static KlineHub& instance();
+
+    // 回调在 context 存活时于主线程调用（不会在 fetch 内同步调用）；返回票据，可用 cancel 撤回
+    quint64 fetch(const KlineRequest& req, QObject* context, Callback cb);
+    // 撤回一个等待者；同组没人等了才真正中止请求
+    void cancel(quint64 ticket);
+
+    // {requests, sent, attached, merged, cancelled, inFlight}
+    QJsonObject stats() const;
+
+signals:
+    // 在途响应缓冲的变化量（收到数据时为正，分发完释放时为负）
+    void bufferDelta(qint64 delta);
+
+private:
+    explicit KlineHub(QObject* parent = nullptr);
+
+    struct Waiter {
+        quint64 ticket = 0;
+        QPointer<QObject> context;
+        Callback cb;
+    };
+    struct Group {
+        QString key;
+        KlineRequest spec;      // 合并后的区间
+        QList<Waiter> waiters;
+        QNetworkReply* reply = nullptr;     // 为空：还在本轮合并窗口内
+        qint64 received = 0;
+        bool finishing = false;             // 正在分发结果
+    };
+
+    static QString keyOf(const KlineRequest& req);
+    static bool covers(const KlineRequest& group, const KlineRequest& req);
+    static void widen(KlineRequest& group, const KlineRequest& req);
+    static QUrl urlOf(const KlineRequest& spec);
+
+    void dispatch();
+    void send(Group* g);
+    void finish(Group* g);
+    void drop(Group* g);
+
+    QNetworkAccessManager* m_nam = nullptr;
+    QTimer* m_dispatchTimer = nullptr;
+    QHash<QString, QList<Group*>> m_groups;
+    QHash<quint64, Group*> m_byTicket;
+    QList<Group*> m_pending;
+    quint64 m_nextTicket = 0;
+
+    quint64 m_requests = 0;
+    quint64 m_sent = 0;
+    quint64 m_attached = 0;     // 挂到已在途的请求上
+    quint64 m_merged = 0;       // 发出前并进同组的请求
+    quint64 m_cancelled = 0;
+};
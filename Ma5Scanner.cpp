@@ -1,5 +1,10 @@
-﻿#include "Ma5Scanner.h"
-#include "QuoteModel.h"
+﻿#include "BacktestCache.h"
+#include "BarStore.h"
+#include "KlineHub.h"
+#include "Ma5Scanner.h"
+#include "MemoryUsage.h"
+#include "PriceBandIndex.h"
+#include "SpotStream.h"
 
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
@@ -10,6 +15,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QStandardPaths>
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
 #include <QSaveFile>
@@ -19,6 +25,36 @@
 
 namespace {
 static const char* kEM_UT = "fa5fd1943c7b386f172d6893dbfba10b";
+static const int kRowBatchSize = 16;
+static const int kRowFlushMs = 250;
+static const int kStreamFlushMs = 200;      // 推送模式下合并一小段时间内的变化再重判
+static const int kMinPollMs = 5000;         // 轮询最短间隔，新浪没有推送时也退回它
+static const int kUiFrameMs = 16;           // 进度 / 阶段文字最多每帧发一次
+static const int kLagProbeMs = 10;          // 事件循环探针间隔
+static const int kPressureCheckPuts = 256;  // 每写这么多条K线缓存查一次进程常驻内存
+static const int kCheckpointMs = 5000;      // 断点落盘间隔
+static const int kCheckpointVersion = 1;
+static const double kNearBand = 0.03;       // 现价离价格带 3% 以内算“接近”，排在无缓存的前面
+
+// Spot 里字符串的堆上部分（sizeof(Spot) 另算）
+static qint64 spotHeapBytes(const Spot& s)
+{
+    return MemoryUsage::ofString(s.code) + MemoryUsage::ofString(s.name) + MemoryUsage::ofString(s.sector)
+        - 3 * qint64(sizeof(QString));
+}
+
+static qint64 rowHeapBytes(const PickRow& r)
+{
+    return MemoryUsage::ofString(r.code) + MemoryUsage::ofString(r.name) + MemoryUsage::ofString(r.sector)
+        - 3 * qint64(sizeof(QString));
+}
+
+static qint64 rowsBytes(const QVector<PickRow>& rows)
+{
+    qint64 bytes = MemoryUsage::ofVector(rows);
+    for (const auto& r : rows) bytes += rowHeapBytes(r);
+    return bytes;
+}
 
 static void FillCommonHeaders(QNetworkRequest& req) {
     req.setRawHeader("User-Agent", "Mozilla/5.0");
@@ -31,13 +67,128 @@ static void FillCommonHeaders(QNetworkRequest& req) {
 Ma5Scanner::Ma5Scanner(QObject* parent) : QObject(parent)
 {
     m_nam = new QNetworkAccessManager(this);
+
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kRowFlushMs);
+    connect(m_flushTimer, &QTimer::timeout, this, &Ma5Scanner::flushPendingRows);
+
+    m_uiFlushTimer = new QTimer(this);
+    m_uiFlushTimer->setSingleShot(true);
+    connect(m_uiFlushTimer, &QTimer::timeout, this, &Ma5Scanner::flushUi);
+
+    // 扫描期间每 10ms 醒一次，实际间隔超出的部分即本线程事件循环被阻塞的时长
+    m_lagTimer = new QTimer(this);
+    m_lagTimer->setTimerType(Qt::PreciseTimer);
+    m_lagTimer->setInterval(kLagProbeMs);
+    connect(m_lagTimer, &QTimer::timeout, this, [this]() {
+        const qint64 elapsedUs = m_lagClock.nsecsElapsed() / 1000;
+        m_lagClock.start();
+        m_metrics.recordLoopLag(elapsedUs - kLagProbeMs * 1000);
+    });
+
+    m_watchTimer = new QTimer(this);
+    connect(m_watchTimer, &QTimer::timeout, this, &Ma5Scanner::watchTick);
+
+    m_streamFlushTimer = new QTimer(this);
+    m_streamFlushTimer->setSingleShot(true);
+    m_streamFlushTimer->setInterval(kStreamFlushMs);
+    connect(m_streamFlushTimer, &QTimer::timeout, this, [this]() {
+        if (m_statesDate != QDate::currentDate()) {
+            stopWatch();
+            emit watchStopped("交易日已切换，请重新完整扫描");
+            return;
+        }
+        finishWatchTick();
+    });
+
+    // K线请求经共享的 KlineHub 发出，它的在途缓冲记到本次扫描
+    connect(&KlineHub::instance(), &KlineHub::bufferDelta, this, [this](qint64 delta) {
+        m_metrics.bufferDelta(delta);
+    });
+
+    m_checkpointTimer = new QTimer(this);
+    m_checkpointTimer->setInterval(kCheckpointMs);
+    connect(m_checkpointTimer, &QTimer::timeout, this, &Ma5Scanner::writeCheckpoint);
+
     loadCache();
 }
 
+Ma5Scanner::~Ma5Scanner()
+{
+    // 扫描中途退出：留下断点，下次启动可续扫
+    writeCheckpoint();
+}
+
 void Ma5Scanner::runOnce(const ScanConfig& cfg)
 {
-    // 先安全取消上次（不清reply回调，靠 m_cancelled 兜住）
-    cancel();
+    resetRun(cfg);
+    beginMetrics(QString());
+    notifyStage("拉取沪深京A股列表...");
+    fetchSpotPage(1);
+}
+
+bool Ma5Scanner::resume(const ScanConfig& cfg)
+{
+    QJsonObject root;
+    if (!readCheckpoint(cfg, &root)) return false;
+
+    resetRun(cfg);
+    beginMetrics("resume ");
+
+    for (const auto& v : root.value("universe").toArray()) {
+        const auto a = v.toArray();
+        Spot s;
+        s.code = a.at(0).toString();
+        s.name = a.at(1).toString();
+        s.sector = a.at(2).toString();
+        s.pe = a.at(3).toDouble();
+        s.market = a.at(4).toInt();
+        s.last = a.at(5).toDouble();
+        if (!s.code.isEmpty()) m_spots.push_back(s);
+    }
+    QHash<QString, int> spotIndex;
+    spotIndex.reserve(m_spots.size());
+    for (int i = 0; i < m_spots.size(); ++i) spotIndex.insert(m_spots[i].code, i);
+
+    for (const auto& v : root.value("done").toArray()) {
+        const QString code = v.toString();
+        if (spotIndex.contains(code)) m_completed.insert(code);
+    }
+    for (const auto& v : root.value("states").toArray()) {
+        const auto a = v.toArray();
+        const int i = spotIndex.value(a.at(0).toString(), -1);
+        if (i < 0) continue;
+        if (!m_cfg.includeBJ && isBeijingCode(m_spots[i].code)) continue;
+        SymbolState st;
+        st.spot = m_spots[i];
+        st.ma5Last = a.at(1).toDouble();
+        st.ma5Prev = a.at(2).toDouble();
+        st.belowStreak = a.at(3).toInt();
+        st.aboveStreak = a.at(4).toInt();
+        addState(st);
+    }
+    flushPendingRows();
+
+    m_metrics.mark(QString("断点恢复：%1 只已完成").arg(m_completed.size()));
+    notifyStage(QString("从断点续扫：已完成 %1 / %2 只").arg(m_completed.size()).arg(m_spots.size()));
+    startKlineQueue();
+    return true;
+}
+
+void Ma5Scanner::resetRun(const ScanConfig& cfg)
+{
+    // 上一轮若已在拉K线，先把断点写下
+    writeCheckpoint();
+    disarmCheckpoint();
+    // 先安全取消上次（不清reply回调，靠 m_cancelled 兜住）；这里不发 cancelled，免得调用方刚置忙就被复位
+    abortInFlight();
+
+    // 完整扫描会重建状态，盯盘的结果集基准随之失效
+    if (!m_watches.isEmpty()) {
+        stopWatch();
+        emit watchStopped("开始完整扫描，盯盘已停止");
+    }
 
     m_cfg = cfg;
     m_cancelled = false;
@@ -45,30 +196,55 @@ void Ma5Scanner::runOnce(const ScanConfig& cfg)
 
     m_spots.clear();
     m_queue.clear();
+    m_queueHead = 0;
+    m_boosted.clear();
+    m_pruned = 0;
+    m_prunedDays = 0;
     m_results.clear();
     m_tasks.clear();
+    m_states.clear();
+    m_stateIndex.clear();
+    m_statesReady = false;
+    m_pendingRows.clear();
+    m_pendingEvictions.clear();
 
     m_done = 0;
     m_inFlight = 0;
     m_totalToDo = 0;
     m_spotTotal = 0;
 
-    loadCache();
+    m_completed.clear();
 
-    emit stageChanged("拉取沪深京A股列表...");
-    fetchSpotPage(1);
+    ++m_cacheScan;
+    m_memoryPressure = MemoryUsage::enforce();
+    // 缓存构造时已载入，之后由本对象维护；只有缓存过期且今天还没重读过时才重新解析文件
+    const QDate today = QDate::currentDate();
+    if (m_cacheDate != today && m_cacheLoadedOn != today) {
+        loadCache();
+    } else {
+        m_cacheFull = false;
+        trimCache();
+    }
 }
 
-void Ma5Scanner::cancel()
+void Ma5Scanner::beginMetrics(const QString& prefix)
 {
-    m_cancelled = true;
-
-    // 清队列：不再发新请求
-    m_queue.clear();
+    m_metrics.begin(QString("%1%2 %3")
+                        .arg(prefix, m_cfg.mode == ScanConfig::Mode::PullbackToMa5 ? "pullback" : "break",
+                             QUrl(m_cfg.spotBaseUrl).host()));
+    m_lagClock.start();
+    m_lagTimer->start();
+}
 
-    // abort 正在进行的请求，但不要清 m_tasks / 不要手动改 m_inFlight
-    for (auto it = m_tasks.begin(); it != m_tasks.end(); ++it) {
-        if (it.key()) it.key()->abort();
+void Ma5Scanner::cancel()
+{
+    writeCheckpoint();
+    disarmCheckpoint();
+    abortInFlight();
+    finishMetrics("cancelled");
+    if (!m_watches.isEmpty()) {
+        stopWatch();
+        emit watchStopped("已取消盯盘");
     }
 
     if (!m_cancelSignalSent) {
@@ -78,6 +254,92 @@ void Ma5Scanner::cancel()
     }
 }
 
+void Ma5Scanner::finishMetrics(const QString& status)
+{
+    if (!m_metrics.isActive()) return;
+    m_lagTimer->stop();
+    m_memoryPressure = MemoryUsage::enforce();
+    trimCache();
+    m_metrics.setMemory(memoryReport());
+    const QJsonObject summary = m_metrics.finish(status, m_results.size());
+    m_metrics.save();
+    emit metricsReady(summary);
+}
+
+void Ma5Scanner::trackBuffer(QNetworkReply* reply)
+{
+    connect(reply, &QNetworkReply::downloadProgress, this, [this, reply](qint64 received, qint64) {
+        qint64& seen = m_replyBuffered[reply];
+        m_metrics.bufferDelta(received - seen);
+        seen = received;
+    });
+    // 连在处理回调之后：解析完才算释放
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        m_metrics.bufferDelta(-m_replyBuffered.take(reply));
+    });
+}
+
+QJsonObject Ma5Scanner::memoryReport() const
+{
+    qint64 spots = MemoryUsage::ofVector(m_spots);
+    for (const auto& s : m_spots) spots += spotHeapBytes(s);
+    qint64 queue = MemoryUsage::ofVector(m_queue) + MemoryUsage::hashOverhead(m_boosted.size());
+    for (const auto& s : m_queue) queue += spotHeapBytes(s);
+    for (const auto& code : m_boosted) queue += MemoryUsage::ofString(code);
+    qint64 tasks = MemoryUsage::hashOverhead(m_tasks.size() + m_replyBuffered.size());
+    for (const auto& t : m_tasks) {
+        tasks += qint64(sizeof(Task)) + spotHeapBytes(t.s) + MemoryUsage::ofString(t.secidUsed)
+            + MemoryUsage::kArrayHeader + qint64(t.marketTryList.size()) * qint64(sizeof(void*));   // Qt5 QList 每格一个指针宽
+    }
+    qint64 states = MemoryUsage::ofVector(m_states) + MemoryUsage::hashOverhead(m_stateIndex.size());
+    for (const auto& st : m_states) states += spotHeapBytes(st.spot);
+    for (auto it = m_stateIndex.cbegin(); it != m_stateIndex.cend(); ++it)
+        states += MemoryUsage::ofString(it.key()) + qint64(sizeof(int));
+    const qint64 cache = m_cacheBytes + MemoryUsage::hashOverhead(m_cache.size());
+    const qint64 results = rowsBytes(m_results);
+    const qint64 pending = rowsBytes(m_pendingRows);
+    const qint64 barStore = BarStore::instance().memoryBytes();
+    const qint64 backtests = BacktestCache::instance().memoryBytes();
+
+    return QJsonObject{
+        {"klineCache", double(cache)},
+        {"klineCacheEntries", m_cache.size()},
+        {"klineCacheLimit", double(cacheLimit())},
+        {"spots", double(spots)},
+        {"queue", double(queue)},
+        {"tasks", double(tasks)},
+        {"results", double(results)},
+        {"pendingRows", double(pending)},
+        {"states", double(states)},
+        {"barStore", double(barStore)},
+        {"backtestCache", double(backtests)},
+        {"total", double(cache + spots + queue + tasks + results + pending + states + barStore + backtests)},
+        {"rss", double(MemoryUsage::residentBytes())},
+        {"peakRss", double(MemoryUsage::peakResidentBytes())},
+        {"memoryPressure", m_memoryPressure},
+    };
+}
+
+void Ma5Scanner::abortInFlight()
+{
+    m_cancelled = true;
+    m_uiFlushTimer->stop();
+    m_stagePending = false;
+    m_progressPending = false;
+
+    // 清队列：不再发新请求
+    m_queue.clear();
+    m_queueHead = 0;
+    m_flushTimer->stop();
+    m_pendingRows.clear();
+    m_pendingEvictions.clear();
+
+    // 撤回在途的K线请求：撤回的不再回调；别的使用方若在等同一份数据，请求照常进行
+    for (auto it = m_tasks.cbegin(); it != m_tasks.cend(); ++it) KlineHub::instance().cancel(it.key());
+    m_tasks.clear();
+    m_inFlight = 0;
+}
+
 QByteArray Ma5Scanner::normalizeJsonMaybeJsonp(const QByteArray& body)
 {
     int lb = body.indexOf('[');
@@ -89,16 +351,54 @@ QByteArray Ma5Scanner::normalizeJsonMaybeJsonp(const QByteArray& body)
     return body;
 }
 
-// ------------------- spot list -------------------
-void Ma5Scanner::fetchSpotPage(int pn)
+// ------------------- ui notifications -------------------
+// 缓存命中时 pumpKline 一圈就能完成上千只，逐只发 progress 会让界面同步重绘上千次；
+// 这里只记最新值，距上次发出不足一帧就等到下一帧再发
+void Ma5Scanner::notifyProgress(int done, int total)
 {
-    if (m_cancelled) return;
+    m_pendingDone = done;
+    m_pendingTotal = total;
+    m_progressPending = true;
+    scheduleUi();
+}
+
+void Ma5Scanner::notifyStage(const QString& text)
+{
+    m_pendingStage = text;
+    m_stagePending = true;
+    scheduleUi();
+}
 
-    QUrl url(m_cfg.spotBaseUrl);
+void Ma5Scanner::scheduleUi()
+{
+    if (m_uiFlushTimer->isActive()) return;
+    const qint64 since = m_uiClock.isValid() ? m_uiClock.elapsed() : kUiFrameMs;
+    if (since >= kUiFrameMs) flushUi();
+    else m_uiFlushTimer->start(int(kUiFrameMs - since));
+}
+
+void Ma5Scanner::flushUi()
+{
+    m_uiFlushTimer->stop();
+    m_uiClock.start();
+    if (m_stagePending) {
+        m_stagePending = false;
+        emit stageChanged(m_pendingStage);
+    }
+    if (m_progressPending) {
+        m_progressPending = false;
+        emit progress(m_pendingDone, m_pendingTotal);
+    }
+}
+
+// ------------------- spot list -------------------
+QNetworkReply* Ma5Scanner::requestSpotPage(const ScanConfig& cfg, int pn)
+{
+    QUrl url(cfg.spotBaseUrl);
     QUrlQuery q;
-    if (m_cfg.provider == ScanConfig::Provider::Sina) {
+    if (cfg.provider == ScanConfig::Provider::Sina) {
         q.addQueryItem("page", QString::number(pn));
-        q.addQueryItem("num", QString::number(m_cfg.pageSize));
+        q.addQueryItem("num", QString::number(cfg.pageSize));
         q.addQueryItem("sort", "code");
         q.addQueryItem("asc", "1");
         q.addQueryItem("node", "hs_a");
@@ -106,7 +406,7 @@ void Ma5Scanner::fetchSpotPage(int pn)
         q.addQueryItem("_s_r_a", "init");
     } else {
         q.addQueryItem("pn", QString::number(pn));
-        q.addQueryItem("pz", QString::number(m_cfg.pageSize));
+        q.addQueryItem("pz", QString::number(cfg.pageSize));
         q.addQueryItem("po", "1");
         q.addQueryItem("np", "2");
         q.addQueryItem("fltt", "2");
@@ -122,47 +422,68 @@ void Ma5Scanner::fetchSpotPage(int pn)
     FillCommonHeaders(req);
 
     auto* reply = m_nam->get(req);
-    QTimer::singleShot(m_cfg.timeoutMs, reply, [reply](){
+    QTimer::singleShot(cfg.timeoutMs, reply, [reply](){
         if (reply && reply->isRunning()) reply->abort();
     });
+    return reply;
+}
+
+bool Ma5Scanner::parseSpotPage(const ScanConfig& cfg, const QByteArray& raw, QVector<Spot>& page, int* total) const
+{
+    if (cfg.provider == ScanConfig::Provider::Sina)
+        return parseSpotPageSina(normalizeJsonMaybeJsonp(raw), page);
+    return parseSpotPageEastmoney(normalizeJsonMaybeJsonp(raw), page, total);
+}
+
+void Ma5Scanner::fetchSpotPage(int pn)
+{
+    if (m_cancelled) return;
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, pn]() {
+    const ScanMetrics::Span span = m_metrics.beginRequest();
+    auto* reply = requestSpotPage(m_cfg, pn);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, pn, span]() {
         const QByteArray raw = reply->readAll();
         const auto err = reply->error();
         const QString errStr = reply->errorString();
+        m_metrics.endRequest(span, "spot", reply->url().host(), raw.size(), err == QNetworkReply::NoError,
+                             QString("page %1").arg(pn));
         reply->deleteLater();
 
         if (m_cancelled) return;
 
         if (err != QNetworkReply::NoError) {
+            finishMetrics("failed");
+            flushUi();
             emit failed(QString("拉取列表失败：%1").arg(errStr));
             return;
         }
 
         QVector<Spot> page;
         int total = 0;
-        if (m_cfg.provider == ScanConfig::Provider::Sina) {
-            if (!parseSpotPageSina(normalizeJsonMaybeJsonp(raw), page)) {
-                emit failed(QString("解析列表失败。响应前200字：%1").arg(QString::fromUtf8(raw.left(200))));
-                return;
-            }
-        } else if (!parseSpotPageEastmoney(normalizeJsonMaybeJsonp(raw), page, &total)) {
+        const qint64 parseStart = m_metrics.nowUs();
+        const bool parsed = parseSpotPage(m_cfg, raw, page, &total);
+        m_metrics.recordParse(parseStart, "spot");
+        if (!parsed) {
+            finishMetrics("failed");
+            flushUi();
             emit failed(QString("解析列表失败。响应前200字：%1").arg(QString::fromUtf8(raw.left(200))));
             return;
         }
         if (total > 0) m_spotTotal = total;
 
         if (page.isEmpty()) {
-            emit stageChanged(QString("列表完成：%1 只，开始计算 MA5 / 条件筛选...").arg(m_spots.size()));
+            m_metrics.mark("列表完成");
+            notifyStage(QString("列表完成：%1 只，开始计算 MA5 / 条件筛选...").arg(m_spots.size()));
             startKlineQueue();
             return;
         }
 
         m_spots += page;
-        emit progress(m_spots.size(), m_spotTotal > 0 ? m_spotTotal : -1);
+        notifyProgress(m_spots.size(), m_spotTotal > 0 ? m_spotTotal : -1);
 
         fetchSpotPage(pn + 1);
     });
+    trackBuffer(reply);
 }
 
 bool Ma5Scanner::parseSpotPageEastmoney(const QByteArray& body, QVector<Spot>& outPage, int* totalOut)
@@ -224,18 +545,57 @@ void Ma5Scanner::startKlineQueue()
 {
     if (m_cancelled) return;
 
-    for (const auto& s : m_spots) {
-        if (!m_cfg.includeBJ) {
-            if (s.code.startsWith("43") || s.code.startsWith("83") ||
-                s.code.startsWith("87") || s.code.startsWith("88"))
-                continue;
+    m_done = 0;
+    m_pruned = 0;
+    const qint64 orderStart = m_metrics.nowUs();
+    QVector<QPair<QueueKey, int>> order;    // (优先级, m_spots 下标)
+    order.reserve(m_spots.size());
+    for (int i = 0; i < m_spots.size(); ++i) {
+        const Spot& s = m_spots[i];
+        if (!m_cfg.includeBJ && isBeijingCode(s.code)) continue;
+        if (m_completed.contains(s.code)) {    // 续扫：断点里已完成
+            ++m_done;
+            continue;
         }
-        m_queue.enqueue(s);
+        // 今天拉的缓存直接命中、还能留下状态；更早的先拿来排除不可能命中的
+        if (pruneByCache(s)) {
+            ++m_pruned;
+            ++m_done;
+            continue;
+        }
+        order.push_back({queueKey(s), i});
+    }
+    if (m_pruned > 0) {
+        m_prunedMode = m_cfg.mode;
+        m_prunedDays = (m_cfg.mode == ScanConfig::Mode::PullbackToMa5) ? m_cfg.pullbackAboveDays : m_cfg.belowDays;
+        m_metrics.add(ScanMetrics::PrunedFetches, m_pruned);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const QPair<QueueKey, int>& a, const QPair<QueueKey, int>& b) {
+        if (a.first.tier != b.first.tier) return a.first.tier < b.first.tier;
+        return a.first.distance < b.first.distance;
+    });
+    int tiers[5] = {};
+    m_queue.clear();
+    m_queue.reserve(order.size());
+    m_queueHead = 0;
+    for (const auto& o : order) {
+        ++tiers[o.first.tier];
+        m_queue.push_back(m_spots[o.second]);
     }
+    m_metrics.add(ScanMetrics::Prioritized, tiers[0]);
+    m_metrics.mark(QString("排队 %1 ms：按缓存跳过 %2，插队 %3，预判命中 %4，接近 %5，无缓存 %6，其余 %7")
+                       .arg((m_metrics.nowUs() - orderStart) / 1000)
+                       .arg(m_pruned)
+                       .arg(tiers[0]).arg(tiers[1]).arg(tiers[2]).arg(tiers[3]).arg(tiers[4]));
 
-    m_done = 0;
-    m_totalToDo = m_queue.size();              // ✅ 固定总数
-    emit progress(0, m_totalToDo);
+    m_totalToDo = m_queue.size() + m_done;     // ✅ 固定总数
+    notifyProgress(m_done, m_totalToDo);
+
+    // 股票池先落一次盘，之后按间隔更新
+    m_checkpointArmed = true;
+    m_checkpointDirty = true;
+    writeCheckpoint();
+    m_checkpointTimer->start();
 
     pumpKline();
 }
@@ -244,8 +604,8 @@ void Ma5Scanner::pumpKline()
 {
     if (m_cancelled) return;
 
-    while (m_inFlight < m_cfg.maxInFlight && !m_queue.isEmpty()) {
-        const Spot s = m_queue.dequeue();
+    while (m_inFlight < m_cfg.maxInFlight && m_queueHead < m_queue.size()) {
+        const Spot s = m_queue[m_queueHead++];
 
         // cache 命中：直接算
         QVector<QString> dates;
@@ -255,30 +615,12 @@ void Ma5Scanner::pumpKline()
         const int need = qMax(m_cfg.belowDays, aboveDays) + 6;
 
         if (cacheGet(secid, dates, closes) && closes.size() >= need) {
-            KlineStats st;
-            const int aboveDays = (m_cfg.mode == ScanConfig::Mode::PullbackToMa5) ? m_cfg.pullbackAboveDays : 0;
-            if (computeStatsFromBars(dates, closes, m_cfg.belowDays, aboveDays, st) && st.ok) {
-                const bool slopeOk = !m_cfg.requireMa5SlopeUp || (st.ma5Last > st.ma5Prev);
-                const bool isBreakAbove = (s.last > st.ma5Last && st.prevNDaysCloseBelowMA5 && slopeOk);
-                const double tol = m_cfg.pullbackTolerancePct / 100.0;
-                const bool nearMa5 = (s.last >= st.ma5Last * (1.0 - tol) && s.last <= st.ma5Last * (1.0 + tol));
-                const bool isPullback = (st.prevNDaysCloseAboveMA5 && slopeOk && nearMa5);
-                const bool match = (m_cfg.mode == ScanConfig::Mode::BreakAboveMa5) ? isBreakAbove : isPullback;
-                if (match) {
-                    const int daysValue = (m_cfg.mode == ScanConfig::Mode::PullbackToMa5)
-                                              ? m_cfg.pullbackAboveDays
-                                              : m_cfg.belowDays;
-                    PickRow r;
-                    r.code = s.code; r.name = s.name; r.market = s.market;
-                    r.sector = s.sector; r.pe = s.pe;
-                    r.last = s.last; r.ma5 = st.ma5Last;
-                    r.biasPct = (r.last / r.ma5 - 1.0) * 100.0;
-                    r.belowDays = daysValue;
-                    m_results.push_back(r);
-                }
-            }
+            m_metrics.add(ScanMetrics::CacheHits);
+            const qint64 computeStart = m_metrics.nowUs();
+            acceptBars(s, dates, closes);
+            m_metrics.recordCompute(computeStart);
             ++m_done;
-            emit progress(m_done, m_totalToDo);
+            notifyProgress(m_done, m_totalToDo);
             continue;
         }
 
@@ -287,24 +629,471 @@ void Ma5Scanner::pumpKline()
     }
 
     // ✅ 只有当队列空 + 无在途，才完成
-    if (!m_cancelled && m_inFlight == 0 && m_queue.isEmpty()) {
-        auto key = [&](const PickRow& r){
-            switch (m_cfg.sortField) {
-            case 1: return std::abs(r.biasPct);
-            case 2: return r.pe;
-            default: return r.biasPct;
-            }
-        };
-        std::sort(m_results.begin(), m_results.end(), [&](const PickRow& a, const PickRow& b){
-            return m_cfg.sortDesc ? (key(a) > key(b)) : (key(a) < key(b));
-        });
+    if (!m_cancelled && m_inFlight == 0 && m_queueHead >= m_queue.size()) {
+        flushPendingRows();
+        if (m_cfg.topK > 0) {
+            // 有界堆里最多 K 只：sort_heap 即按排名从好到差
+            std::sort_heap(m_results.begin(), m_results.end(), [this](const PickRow& a, const PickRow& b){
+                return rankBefore(a, b, m_cfg);
+            });
+        } else {
+            sortRows(m_results, m_cfg);
+        }
+        m_statesReady = true;
+        m_statesDate = QDate::currentDate();
 
+        disarmCheckpoint();
+        QFile::remove(checkpointPath(m_cfg.mode));
         saveCache();
-        emit stageChanged(QString("完成：%1 只满足条件").arg(m_results.size()));
+        finishMetrics("ok");
+        notifyStage(QString("完成：%1 只满足条件").arg(m_results.size()));
+        flushUi();
         emit finished(m_results);
     }
 }
 
+void Ma5Scanner::prioritize(const QStringList& codes)
+{
+    QSet<QString> fresh;
+    for (const auto& code : codes) {
+        if (!m_boosted.contains(code)) fresh.insert(code);
+    }
+    if (fresh.isEmpty()) return;
+    m_boosted.unite(fresh);
+    if (m_queueHead >= m_queue.size()) return;     // 还没排队：排队时放进第一档
+
+    // 已在排队：把它们稳定地挪到剩余部分的最前面
+    const auto moved = std::stable_partition(m_queue.begin() + m_queueHead, m_queue.end(), [&fresh](const Spot& s) {
+        return fresh.contains(s.code);
+    });
+    const int n = int(moved - (m_queue.begin() + m_queueHead));
+    if (n > 0) {
+        m_metrics.add(ScanMetrics::Prioritized, n);
+        m_metrics.mark(QString("插队 %1 只").arg(n));
+    }
+}
+
+Ma5Scanner::QueueKey Ma5Scanner::queueKey(const Spot& s) const
+{
+    if (m_boosted.contains(s.code)) return {0, 0};
+
+    // 昨天收盘后存的缓存，推出的状态就是今天判定用的状态；更早的缓存只是近似，只影响先后
+    SymbolState st;
+    if (!cachedState(s, &st)) return {3, 0};
+    st.spot = s;
+    PriceBand band;
+    if (!PriceBandIndex::bandFor(st, m_cfg, &band)) return {4, 1};
+    if (band.contains(s.last)) return {1, 0};
+    const double gap = (s.last <= band.lo ? band.lo - s.last : s.last - band.hi) / st.ma5Last;
+    return {gap <= kNearBand ? 2 : 4, gap};
+}
+
+bool Ma5Scanner::cachedState(const Spot& s, SymbolState* out) const
+{
+    auto it = m_cache.constFind(secidFor(s));
+    if (it == m_cache.constEnd()) return false;
+    KlineStats st;
+    if (!computeStatsFromBars(it->dates, it->closes, 0, 0, st) || !st.ok) return false;
+    out->ma5Last = st.ma5Last;
+    out->ma5Prev = st.ma5Prev;
+    out->belowStreak = st.belowStreak;
+    out->aboveStreak = st.aboveStreak;
+    return true;
+}
+
+// 真实序列 = 缓存里确定收盘的K线 + 之后最多 unknown 根未知K线。streak 从倒数第二根往前数：
+// 没有新K线时就是缓存里截至倒数第二根的连续天数；有 k 根时是 k-1 根未知（全按有利算）
+// 接上缓存最后一根往前的连续天数。两者都凑不够 N 就不可能命中
+bool Ma5Scanner::pruneByCache(const Spot& s)
+{
+    const bool pullback = (m_cfg.mode == ScanConfig::Mode::PullbackToMa5);
+    const int days = pullback ? m_cfg.pullbackAboveDays : m_cfg.belowDays;
+    if (days <= 0) return false;
+
+    auto it = m_cache.find(secidFor(s));
+    if (it == m_cache.end() || it->fetched == QDate::currentDate()) return false;
+    const QVector<QString>& d = it->dates;
+    const QVector<double>& c = it->closes;
+
+    // 今天及以后的不算；缓存最后一根可能是当时的盘中K线，也当未知
+    const QString today = QDate::currentDate().toString("yyyy-MM-dd");
+    int m = c.size();
+    while (m > 0 && d[m - 1] >= today) --m;
+    --m;
+    if (m < 6) return false;
+    const QDate last = QDate::fromString(d[m - 1], "yyyy-MM-dd");
+    if (!last.isValid()) return false;
+
+    // 之后到昨天的工作日都可能有一根（节假日只会更少）；多到足以凑满 N 就不用算了
+    int unknown = 0;
+    for (QDate x = last.addDays(1); x < QDate::currentDate(); x = x.addDays(1)) {
+        if (x.dayOfWeek() <= 5 && ++unknown > days) return false;
+    }
+
+    auto ma5At = [&c](int idx) {
+        double sum = 0;
+        for (int j = idx - 4; j <= idx; ++j) sum += c[j];
+        return sum / 5.0;
+    };
+    auto runFrom = [&](int idx) {
+        int run = 0;
+        for (; idx >= 4 && (pullback ? c[idx] > ma5At(idx) : c[idx] < ma5At(idx)); --idx) ++run;
+        return run;
+    };
+    int best = runFrom(m - 2);
+    if (unknown > 0) best = qMax(best, unknown - 1 + runFrom(m - 1));
+    if (best >= days) return false;
+
+    // 明天还要靠它判断，别被裁掉；fetched 不动，同一天再扫也不会当成当天数据命中
+    it->scan = m_cacheScan;
+    return true;
+}
+
+// 收盘K线 -> 派生状态（streak / MA5 / 斜率），并按当前参数判定一次
+void Ma5Scanner::acceptBars(const Spot& s, const QVector<QString>& dates, const QVector<double>& closes)
+{
+    m_completed.insert(s.code);
+    m_checkpointDirty = true;
+
+    KlineStats st;
+    if (!computeStatsFromBars(dates, closes, 0, 0, st) || !st.ok) return;
+
+    SymbolState state;
+    state.spot = s;
+    state.ma5Last = st.ma5Last;
+    state.ma5Prev = st.ma5Prev;
+    state.belowStreak = st.belowStreak;
+    state.aboveStreak = st.aboveStreak;
+    addState(state);
+}
+
+void Ma5Scanner::addState(const SymbolState& state)
+{
+    m_stateIndex.insert(state.spot.code, m_states.size());
+    m_states.push_back(state);
+
+    PickRow r;
+    if (!evaluateState(state, m_cfg, &r)) return;
+
+    PickRow evicted;
+    if (m_cfg.topK > 0) {
+        const int before = m_results.size();
+        if (!pushTopK(m_results, r, m_cfg, &evicted)) return;
+        if (m_results.size() == before) {
+            // 被挤出的还没推送过：直接从待发批次里去掉，否则通知界面删除
+            auto it = std::find_if(m_pendingRows.begin(), m_pendingRows.end(), [&](const PickRow& p){
+                return p.code == evicted.code;
+            });
+            if (it != m_pendingRows.end()) m_pendingRows.erase(it);
+            else m_pendingEvictions.push_back(evicted.code);
+        }
+    } else {
+        m_results.push_back(r);
+    }
+
+    m_pendingRows.push_back(r);
+    if (m_pendingRows.size() >= kRowBatchSize) {
+        flushPendingRows();
+    } else if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void Ma5Scanner::flushPendingRows()
+{
+    m_flushTimer->stop();
+    if (m_cancelled) return;
+
+    if (!m_pendingEvictions.isEmpty()) {
+        QStringList codes;
+        codes.swap(m_pendingEvictions);
+        emit rowsEvicted(codes);
+    }
+    if (!m_pendingRows.isEmpty()) {
+        QVector<PickRow> batch;
+        batch.swap(m_pendingRows);
+        m_metrics.firstResult();
+        emit rowsFound(batch);
+    }
+}
+
+bool Ma5Scanner::isBeijingCode(const QString& code)
+{
+    return code.startsWith("43") || code.startsWith("83") ||
+           code.startsWith("87") || code.startsWith("88");
+}
+
+bool Ma5Scanner::evaluateState(const SymbolState& st, const ScanConfig& cfg, PickRow* out)
+{
+    const Spot& s = st.spot;
+    // 前置条件 + 价格带，与盯盘的触发索引同一份判定
+    PriceBand band;
+    if (!PriceBandIndex::bandFor(st, cfg, &band) || !band.contains(s.last)) return false;
+
+    if (out) {
+        PickRow& r = *out;
+        r.code = s.code; r.name = s.name; r.market = s.market;
+        r.sector = s.sector; r.pe = s.pe;
+        r.last = s.last; r.ma5 = st.ma5Last;
+        r.biasPct = (r.last / r.ma5 - 1.0) * 100.0;
+        r.belowDays = (cfg.mode == ScanConfig::Mode::PullbackToMa5) ? cfg.pullbackAboveDays : cfg.belowDays;
+    }
+    return true;
+}
+
+bool Ma5Scanner::rankBefore(const PickRow& a, const PickRow& b, const ScanConfig& cfg)
+{
+    auto key = [&](const PickRow& r){
+        switch (cfg.sortField) {
+        case 1: return std::abs(r.biasPct);
+        case 2: return r.pe;
+        default: return r.biasPct;
+        }
+    };
+    return cfg.sortDesc ? (key(a) > key(b)) : (key(a) < key(b));
+}
+
+void Ma5Scanner::sortRows(QVector<PickRow>& rows, const ScanConfig& cfg)
+{
+    std::sort(rows.begin(), rows.end(), [&](const PickRow& a, const PickRow& b){
+        return rankBefore(a, b, cfg);
+    });
+}
+
+// heap 顶是当前 K 只里排名最差的一只；满了以后新行只有比它好才替换
+bool Ma5Scanner::pushTopK(QVector<PickRow>& heap, const PickRow& r, const ScanConfig& cfg, PickRow* evicted)
+{
+    auto comp = [&](const PickRow& a, const PickRow& b){ return rankBefore(a, b, cfg); };
+    if (heap.size() < cfg.topK) {
+        heap.push_back(r);
+        std::push_heap(heap.begin(), heap.end(), comp);
+        return true;
+    }
+    if (heap.isEmpty() || !rankBefore(r, heap.front(), cfg)) return false;
+
+    std::pop_heap(heap.begin(), heap.end(), comp);
+    if (evicted) *evicted = heap.back();
+    heap.back() = r;
+    std::push_heap(heap.begin(), heap.end(), comp);
+    return true;
+}
+
+bool Ma5Scanner::statesCover(const ScanConfig& cfg) const
+{
+    if (!m_statesReady) return false;
+    if (m_prunedDays <= 0) return true;
+    const int days = (cfg.mode == ScanConfig::Mode::PullbackToMa5) ? cfg.pullbackAboveDays : cfg.belowDays;
+    return cfg.mode == m_prunedMode && days >= m_prunedDays;
+}
+
+QVector<PickRow> Ma5Scanner::reevaluate(const ScanConfig& cfg) const
+{
+    QVector<PickRow> rows;
+    if (!statesCover(cfg)) return rows;
+
+    PickRow r;
+    for (const auto& st : m_states) {
+        if (!cfg.includeBJ && isBeijingCode(st.spot.code)) continue;
+        if (!evaluateState(st, cfg, &r)) continue;
+        if (cfg.topK > 0) pushTopK(rows, r, cfg, nullptr);
+        else rows.push_back(r);
+    }
+    sortRows(rows, cfg);
+    return rows;
+}
+
+// ------------------- watch -------------------
+bool Ma5Scanner::watch(const ScanConfig& cfg, int intervalMs)
+{
+    // 状态里的 streak / MA5 截至昨天收盘，跨日就不对了
+    if (!statesCover(cfg) || m_statesDate != QDate::currentDate()) return false;
+
+    if (intervalMs <= 0 && cfg.provider == ScanConfig::Provider::Sina) intervalMs = kMinPollMs;
+
+    WatchSlot& slot = m_watches[static_cast<int>(cfg.mode)];
+    slot.cfg = cfg;
+    slot.intervalMs = intervalMs <= 0 ? 0 : qMax(kMinPollMs, intervalMs);
+    // 以当前价格下的带内状态为基准，之后只报穿越
+    slot.bands.build(m_states, cfg);
+    slot.entered.clear();
+    slot.exited.clear();
+
+    m_watchFetchCfg = cfg;
+    restartWatchTimer();
+    return true;
+}
+
+void Ma5Scanner::unwatch(ScanConfig::Mode mode)
+{
+    m_watches.remove(static_cast<int>(mode));
+    if (m_watches.isEmpty()) stopWatch();
+    else restartWatchTimer();
+}
+
+void Ma5Scanner::stopWatch()
+{
+    m_watches.clear();
+    m_watchTimer->stop();
+    m_streamFlushTimer->stop();
+    if (m_stream) m_stream->stop();
+    ++m_watchGen;
+    const auto replies = m_watchReplies;
+    m_watchReplies.clear();
+    for (auto* reply : replies) reply->abort();
+}
+
+void Ma5Scanner::restartWatchTimer()
+{
+    // intervalMs == 0 的槽走 SSE 推送，其余按最短间隔轮询
+    int interval = 0;
+    bool streaming = false;
+    for (const auto& slot : m_watches) {
+        if (slot.intervalMs == 0) {
+            streaming = true;
+            continue;
+        }
+        if (interval == 0 || slot.intervalMs < interval) interval = slot.intervalMs;
+    }
+
+    if (streaming) {
+        if (!m_stream) {
+            m_stream = new SpotStream(this);
+            connect(m_stream, &SpotStream::spotsChanged, this, [this](QVector<Spot> changed) {
+                for (const auto& spot : changed) applyWatchSpot(spot);
+                if (!m_streamFlushTimer->isActive()) m_streamFlushTimer->start();
+            });
+            connect(m_stream, &SpotStream::connected, this, [this]() {
+                notifyStage("行情推送已连接");
+            });
+            connect(m_stream, &SpotStream::disconnected, this, [this](const QString& reason) {
+                notifyStage(QString("行情推送断开：%1，重连中...").arg(reason));
+            });
+        }
+        m_stream->start(m_watchFetchCfg);
+    } else if (m_stream) {
+        m_stream->stop();
+    }
+
+    if (interval <= 0) {
+        m_watchTimer->stop();
+        return;
+    }
+    m_watchTimer->setInterval(interval);
+    if (!m_watchTimer->isActive()) m_watchTimer->start();
+}
+
+void Ma5Scanner::watchTick()
+{
+    // 上一轮还没回来就跳过这一拍，不叠加请求
+    if (m_watches.isEmpty() || !m_watchReplies.isEmpty()) return;
+
+    if (m_statesDate != QDate::currentDate()) {
+        stopWatch();
+        emit watchStopped("交易日已切换，请重新完整扫描");
+        return;
+    }
+
+    ++m_watchGen;
+    m_watchFailed = false;
+    m_watchLastPage = 0;
+    m_watchNextPage = 2;
+    requestWatchPage(1);
+}
+
+void Ma5Scanner::requestWatchPage(int pn)
+{
+    auto* reply = requestSpotPage(m_watchFetchCfg, pn);
+    m_watchReplies.append(reply);
+    const quint64 gen = m_watchGen;
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, pn, gen]() {
+        const QByteArray raw = reply->readAll();
+        const auto err = reply->error();
+        const QString errStr = reply->errorString();
+        reply->deleteLater();
+        m_watchReplies.removeAll(reply);
+
+        if (gen != m_watchGen) return;
+
+        QVector<Spot> page;
+        int total = 0;
+        if (err != QNetworkReply::NoError || !parseSpotPage(m_watchFetchCfg, raw, page, &total)) {
+            // 任一页失败本轮就不推送，等下一拍；已写入的新价不影响收盘状态
+            if (!m_watchFailed) {
+                notifyStage(QString("盯盘刷新失败：%1，保留上次结果")
+                                      .arg(err != QNetworkReply::NoError ? errStr : QString("解析列表失败")));
+            }
+            m_watchFailed = true;
+        } else {
+            for (const auto& spot : page) applyWatchSpot(spot);
+
+            if (pn == 1 && total > 0) {
+                const int pageSize = qMax(1, m_watchFetchCfg.pageSize);
+                m_watchLastPage = (total + pageSize - 1) / pageSize;
+            }
+            if (m_watchLastPage > 0) {
+                // 东财：总页数已知，其余页并发拉
+                const int maxInFlight = qMax(1, m_watchFetchCfg.maxInFlight);
+                while (m_watchNextPage <= m_watchLastPage && m_watchReplies.size() < maxInFlight)
+                    requestWatchPage(m_watchNextPage++);
+            } else if (!page.isEmpty()) {
+                // 新浪不给总数：逐页拉到空页为止
+                requestWatchPage(m_watchNextPage++);
+            }
+        }
+
+        if (m_watchReplies.isEmpty() && !m_watchFailed) finishWatchTick();
+    });
+}
+
+void Ma5Scanner::applyWatchSpot(const Spot& spot)
+{
+    // 只更新现价和市盈率；收盘K线派生的 MA5 / streak 原样保留
+    const int idx = m_stateIndex.value(spot.code, -1);
+    if (idx < 0) return;
+    SymbolState& st = m_states[idx];
+    st.spot.last = spot.last;
+    if (spot.pe != 0) st.spot.pe = spot.pe;
+    for (auto& slot : m_watches) {
+        const int crossed = slot.bands.update(spot.code, spot.last);
+        if (crossed > 0) {
+            if (!slot.exited.remove(spot.code)) slot.entered.insert(spot.code);
+        } else if (crossed < 0) {
+            if (!slot.entered.remove(spot.code)) slot.exited.insert(spot.code);
+        }
+    }
+}
+
+void Ma5Scanner::finishWatchTick()
+{
+    // 先算完再统一发：接收方可能在槽里 unwatch
+    struct Update { ScanConfig::Mode mode; QVector<PickRow> rows; QStringList entered, exited; };
+    QVector<Update> updates;
+    for (auto it = m_watches.begin(); it != m_watches.end(); ++it) {
+        WatchSlot& slot = it.value();
+
+        // 只需遍历带内的股票，不必全市场重判
+        QVector<PickRow> rows;
+        PickRow r;
+        for (int idx : slot.bands.insideStates()) {
+            if (!evaluateState(m_states[idx], slot.cfg, &r)) continue;
+            if (slot.cfg.topK > 0) pushTopK(rows, r, slot.cfg, nullptr);
+            else rows.push_back(r);
+        }
+        sortRows(rows, slot.cfg);
+
+        QStringList entered = slot.entered.values();
+        QStringList exited = slot.exited.values();
+        entered.sort();
+        exited.sort();
+        slot.entered.clear();
+        slot.exited.clear();
+
+        updates.push_back({slot.cfg.mode, rows, entered, exited});
+    }
+    for (const auto& u : updates) emit watchUpdated(u.mode, u.rows, u.entered, u.exited);
+}
+
 // ------------------- kline task (fixed retry logic) -------------------
 QString Ma5Scanner::secidFor(const Spot& s, int marketOverride) const
 {
@@ -342,117 +1131,95 @@ void Ma5Scanner::sendKlineTask(Task t)
     const int aboveDays = (m_cfg.mode == ScanConfig::Mode::PullbackToMa5) ? m_cfg.pullbackAboveDays : 0;
     const int needLmt = qMax(40, qMax(m_cfg.belowDays, aboveDays) + 15);
 
-    QUrl url(m_cfg.klineBaseUrl);
-    QUrlQuery q;
+    KlineRequest kr;
+    kr.timeoutMs = m_cfg.timeoutMs;
     if (m_cfg.provider == ScanConfig::Provider::Sina) {
         const bool isShanghai = (t.s.market == 1 || t.s.code.startsWith("6"));
         const QString symbol = QString("%1%2").arg(isShanghai ? "sh" : "sz", t.s.code);
+        QUrl url(m_cfg.klineBaseUrl);
+        QUrlQuery q;
         q.addQueryItem("symbol", symbol);
         q.addQueryItem("scale", "240");
         q.addQueryItem("ma", "no");
         q.addQueryItem("datalen", QString::number(needLmt));
+        url.setQuery(q);
+        kr.rawUrl = url;
     } else {
-        q.addQueryItem("secid", t.secidUsed);
-        q.addQueryItem("klt", "101");
-        q.addQueryItem("fqt", "0");
-        q.addQueryItem("beg", "0");
-        q.addQueryItem("end", "20500101");
-        q.addQueryItem("lmt", QString::number(needLmt));
-        q.addQueryItem("rtntype", "6");
-        q.addQueryItem("ut", kEM_UT);
-        q.addQueryItem("fields1", "f1,f2,f3,f4");
-        q.addQueryItem("fields2", "f51,f52,f53");
+        kr.baseUrl = m_cfg.klineBaseUrl;
+        kr.secid = t.secidUsed;
+        kr.tail = needLmt;
     }
-    url.setQuery(q);
-
-    QNetworkRequest req(url);
-    FillCommonHeaders(req);
 
-    auto* reply = m_nam->get(req);
+    t.span = m_metrics.beginRequest();
     ++m_inFlight;
-    m_tasks.insert(reply, t);
-
-    QTimer::singleShot(m_cfg.timeoutMs, reply, [reply](){
-        if (reply && reply->isRunning()) reply->abort();
+    const quint64 ticket = KlineHub::instance().fetch(kr, this, [this](quint64 ticket, const KlineResult& res) {
+        Task t = m_tasks.take(ticket); // 保留 task 状态
+        m_metrics.endRequest(t.span, "kline", res.host, res.body.size(), res.ok, t.secidUsed);
+        if (res.waiters > 1) m_metrics.add(ScanMetrics::SharedFetches);
+        handleKlineResult(t, res);
     });
+    m_tasks.insert(ticket, t);
+}
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        Task t = m_tasks.take(reply); // 保留 task 状态
-        const QByteArray raw = reply->readAll();
-        const auto err = reply->error();
-        reply->deleteLater();
-
-        if (m_inFlight > 0) --m_inFlight;
+void Ma5Scanner::handleKlineResult(Task t, const KlineResult& res)
+{
+    if (m_inFlight > 0) --m_inFlight;
 
-        // 取消后：不再做任何统计/续跑（避免崩）
-        if (m_cancelled) {
-            return;
-        }
+    // 取消后：不再做任何统计/续跑（避免崩）
+    if (m_cancelled) {
+        return;
+    }
 
-        QVector<QString> dates;
-        QVector<double> closes;
-        bool okBars = (err == QNetworkReply::NoError) && parseKlineBars(normalizeJsonMaybeJsonp(raw), m_cfg, dates, closes);
-
-        if (!okBars) {
-            // ✅ 失败：优先换 market；都试过再按 retry 次数重试
-            if (t.marketTryIndex + 1 < t.marketTryList.size()) {
-                ++t.marketTryIndex;
-                // 不算 done，继续发
-                sendKlineTask(t);
-                pumpKline();
-                return;
-            }
-            if (t.retry < m_cfg.maxRetries) {
-                ++t.retry;
-                t.marketTryIndex = 0;
-                sendKlineTask(t);
-                pumpKline();
-                return;
-            }
+    QVector<QString> dates;
+    QVector<double> closes;
+    bool okBars = false;
+    if (res.ok) {
+        const qint64 parseStart = m_metrics.nowUs();
+        okBars = parseKlineBars(normalizeJsonMaybeJsonp(res.body), m_cfg, dates, closes);
+        m_metrics.recordParse(parseStart, "kline");
+    }
 
-            // ✅ 最终放弃：现在才算 done
-            ++m_done;
-            emit progress(m_done, m_totalToDo);
+    if (!okBars) {
+        // ✅ 失败：优先换 market；都试过再按 retry 次数重试
+        if (t.marketTryIndex + 1 < t.marketTryList.size()) {
+            ++t.marketTryIndex;
+            m_metrics.add(ScanMetrics::MarketFallbacks);
+            // 不算 done，继续发
+            sendKlineTask(t);
             pumpKline();
             return;
         }
-
-        // 成功：写缓存
-        if (dates.size() > 80) {
-            const int drop = dates.size() - 80;
-            dates = dates.mid(drop);
-            closes = closes.mid(drop);
-        }
-        cachePut(t.secidUsed, dates, closes);
-
-        KlineStats st;
-        const int aboveDays = (m_cfg.mode == ScanConfig::Mode::PullbackToMa5) ? m_cfg.pullbackAboveDays : 0;
-        if (computeStatsFromBars(dates, closes, m_cfg.belowDays, aboveDays, st) && st.ok) {
-            const bool slopeOk = !m_cfg.requireMa5SlopeUp || (st.ma5Last > st.ma5Prev);
-            const bool isBreakAbove = (t.s.last > st.ma5Last && st.prevNDaysCloseBelowMA5 && slopeOk);
-            const double tol = m_cfg.pullbackTolerancePct / 100.0;
-            const bool nearMa5 = (t.s.last >= st.ma5Last * (1.0 - tol) && t.s.last <= st.ma5Last * (1.0 + tol));
-            const bool isPullback = (st.prevNDaysCloseAboveMA5 && slopeOk && nearMa5);
-            const bool match = (m_cfg.mode == ScanConfig::Mode::BreakAboveMa5) ? isBreakAbove : isPullback;
-            if (match) {
-                const int daysValue = (m_cfg.mode == ScanConfig::Mode::PullbackToMa5)
-                                          ? m_cfg.pullbackAboveDays
-                                          : m_cfg.belowDays;
-                PickRow r;
-                r.code = t.s.code; r.name = t.s.name; r.market = t.s.market;
-                r.sector = t.s.sector; r.pe = t.s.pe;
-                r.last = t.s.last; r.ma5 = st.ma5Last;
-                r.biasPct = (r.last / r.ma5 - 1.0) * 100.0;
-                r.belowDays = daysValue;
-                m_results.push_back(r);
-            }
+        if (t.retry < m_cfg.maxRetries) {
+            ++t.retry;
+            m_metrics.add(ScanMetrics::Retries);
+            t.marketTryIndex = 0;
+            sendKlineTask(t);
+            pumpKline();
+            return;
         }
 
-        // ✅ 成功：算 done 一次
+        // ✅ 最终放弃：现在才算 done
         ++m_done;
-        emit progress(m_done, m_totalToDo);
+        notifyProgress(m_done, m_totalToDo);
         pumpKline();
-    });
+        return;
+    }
+
+    // 成功：写缓存
+    if (dates.size() > 80) {
+        const int drop = dates.size() - 80;
+        dates = dates.mid(drop);
+        closes = closes.mid(drop);
+    }
+    cachePut(t.secidUsed, dates, closes);
+    const qint64 computeStart = m_metrics.nowUs();
+    acceptBars(t.s, dates, closes);
+    m_metrics.recordCompute(computeStart);
+
+    // ✅ 成功：算 done 一次
+    ++m_done;
+    notifyProgress(m_done, m_totalToDo);
+    pumpKline();
 }
 
 bool Ma5Scanner::parseKlineBars(const QByteArray& body, const ScanConfig& cfg, QVector<QString>& dates, QVector<double>& closes)
@@ -545,32 +1312,96 @@ bool Ma5Scanner::computeStatsFromBars(const QVector<QString>& dates, const QVect
     out.ma5Last = ma5At(n - 1);
     out.ma5Prev = (n >= 6) ? ma5At(n - 2) : out.ma5Last;
 
-    bool allBelow = true;
-    for (int offset = belowDays; offset >= 1; --offset) {
-        const int idx = n - 1 - offset;
-        if (idx < 4) { allBelow = false; break; }
-        const double ma = ma5At(idx);
-        if (!(c[idx] < ma)) { allBelow = false; break; }
-    }
+    // 从倒数第二根往前数连续天数；N 天判定只需比较 streak >= N
+    int belowStreak = 0;
+    for (int idx = n - 2; idx >= 4 && c[idx] < ma5At(idx); --idx) ++belowStreak;
+    int aboveStreak = 0;
+    for (int idx = n - 2; idx >= 4 && c[idx] > ma5At(idx); --idx) ++aboveStreak;
 
-    bool allAbove = true;
-    if (aboveDays <= 0) {
-        allAbove = false;
-    } else {
-        for (int offset = aboveDays; offset >= 1; --offset) {
-            const int idx = n - 1 - offset;
-            if (idx < 4) { allAbove = false; break; }
-            const double ma = ma5At(idx);
-            if (!(c[idx] > ma)) { allAbove = false; break; }
-        }
-    }
+    const bool allBelow = belowStreak >= belowDays;
+    const bool allAbove = aboveDays > 0 && aboveStreak >= aboveDays;
 
     out.ok = true;
     out.prevNDaysCloseBelowMA5 = allBelow;
     out.prevNDaysCloseAboveMA5 = allAbove;
+    out.belowStreak = belowStreak;
+    out.aboveStreak = aboveStreak;
+    return true;
+}
+
+// ------------------- checkpoint -------------------
+QString Ma5Scanner::checkpointPath(ScanConfig::Mode mode)
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/checkpoints";
+    QDir().mkpath(dir);
+    return dir + (mode == ScanConfig::Mode::PullbackToMa5 ? "/pullback.json" : "/break.json");
+}
+
+bool Ma5Scanner::readCheckpoint(const ScanConfig& cfg, QJsonObject* root)
+{
+    QFile f(checkpointPath(cfg.mode));
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    const auto doc = QJsonDocument::fromJson(f.readAll());
+    f.close();
+    if (!doc.isObject()) return false;
+
+    // 跨日后收盘K线变了；换了K线源则 secid / 复权口径可能不同
+    const auto o = doc.object();
+    if (o.value("v").toInt() != kCheckpointVersion) return false;
+    if (QDate::fromString(o.value("date").toString(), Qt::ISODate) != QDate::currentDate()) return false;
+    if (o.value("provider").toInt() != static_cast<int>(cfg.provider)) return false;
+    if (o.value("kline").toString() != cfg.klineBaseUrl) return false;
+    if (o.value("universe").toArray().isEmpty()) return false;
+    *root = o;
+    return true;
+}
+
+bool Ma5Scanner::checkpointInfo(const ScanConfig& cfg, int* done, int* total)
+{
+    QJsonObject root;
+    if (!readCheckpoint(cfg, &root)) return false;
+    if (done) *done = root.value("done").toArray().size();
+    if (total) *total = root.value("universe").toArray().size();
     return true;
 }
 
+void Ma5Scanner::writeCheckpoint()
+{
+    if (!m_checkpointArmed || !m_checkpointDirty) return;
+    m_checkpointDirty = false;
+
+    QJsonArray universe;
+    for (const auto& s : m_spots)
+        universe.append(QJsonArray{s.code, s.name, s.sector, s.pe, s.market, s.last});
+    QJsonArray done;
+    for (const auto& code : m_completed) done.append(code);
+    QJsonArray states;
+    for (const auto& st : m_states)
+        states.append(QJsonArray{st.spot.code, st.ma5Last, st.ma5Prev, st.belowStreak, st.aboveStreak});
+
+    QJsonObject root;
+    root.insert("v", kCheckpointVersion);
+    root.insert("date", QDate::currentDate().toString(Qt::ISODate));
+    root.insert("savedAt", QDateTime::currentDateTime().toString(Qt::ISODate));
+    root.insert("provider", static_cast<int>(m_cfg.provider));
+    root.insert("kline", m_cfg.klineBaseUrl);
+    root.insert("universe", universe);
+    root.insert("done", done);
+    root.insert("states", states);
+
+    QSaveFile f(checkpointPath(m_cfg.mode));
+    if (!f.open(QIODevice::WriteOnly)) return;
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    f.commit();
+}
+
+void Ma5Scanner::disarmCheckpoint()
+{
+    m_checkpointTimer->stop();
+    m_checkpointArmed = false;
+    m_checkpointDirty = false;
+}
+
 // ------------------- cache -------------------
 QString Ma5Scanner::cachePath() const
 {
@@ -583,17 +1414,22 @@ void Ma5Scanner::loadCache()
 {
     const QString path = cachePath();
     QFile f(path);
-    if (!f.exists()) { m_cache.clear(); m_cacheDate = QDate(); return; }
-    if (!f.open(QIODevice::ReadOnly)) { m_cache.clear(); m_cacheDate = QDate(); return; }
+    m_cache.clear();
+    m_cacheBytes = 0;
+    m_cacheFull = false;
+    m_cacheLoadedOn = QDate::currentDate();
+    if (!f.exists()) { m_cacheDate = QDate(); return; }
+    if (!f.open(QIODevice::ReadOnly)) { m_cacheDate = QDate(); return; }
 
     auto doc = QJsonDocument::fromJson(f.readAll());
     f.close();
-    if (!doc.isObject()) { m_cache.clear(); m_cacheDate = QDate(); return; }
+    if (!doc.isObject()) { m_cacheDate = QDate(); return; }
 
     const auto root = doc.object();
     m_cacheDate = QDate::fromString(root.value("date").toString(), Qt::ISODate);
 
-    m_cache.clear();
+    // 超过上限的部分不载入，这些股票本轮重新拉取
+    const qint64 limit = cacheLimit();
     const auto items = root.value("items").toObject();
     for (auto it = items.begin(); it != items.end(); ++it) {
         const QString secid = it.key();
@@ -606,9 +1442,14 @@ void Ma5Scanner::loadCache()
         ci.closes.reserve(jc.size());
         for (auto v : jd) ci.dates.push_back(v.toString());
         for (auto v : jc) ci.closes.push_back(v.toDouble());
-
-        if (!ci.closes.isEmpty() && ci.dates.size() == ci.closes.size())
-            m_cache.insert(secid, ci);
+        // 旧格式没有拉取日期：当作过期，只用于排序和剪枝
+        ci.fetched = QDate::fromString(obj.value("f").toString(), Qt::ISODate);
+
+        if (ci.closes.isEmpty() || ci.dates.size() != ci.closes.size()) continue;
+        ci.bytes = MemoryUsage::ofString(secid) + MemoryUsage::ofStrings(ci.dates) + MemoryUsage::ofVector(ci.closes);
+        if (limit > 0 && m_cacheBytes + ci.bytes > limit) break;
+        m_cacheBytes += ci.bytes;
+        m_cache.insert(secid, ci);
     }
 }
 
@@ -625,6 +1466,7 @@ void Ma5Scanner::saveCache()
         QJsonObject obj;
         obj.insert("d", jd);
         obj.insert("c", jc);
+        obj.insert("f", it.value().fetched.toString(Qt::ISODate));
         items.insert(it.key(), obj);
     }
 
@@ -638,13 +1480,12 @@ void Ma5Scanner::saveCache()
     f.commit();
 }
 
-bool Ma5Scanner::cacheGet(const QString& secid, QVector<QString>& dates, QVector<double>& closes) const
+bool Ma5Scanner::cacheGet(const QString& secid, QVector<QString>& dates, QVector<double>& closes)
 {
-    if (!m_cacheDate.isValid() || m_cacheDate != QDate::currentDate()) return false;
-
     auto it = m_cache.find(secid);
-    if (it == m_cache.end()) return false;
+    if (it == m_cache.end() || it->fetched != QDate::currentDate()) return false;
 
+    it->scan = m_cacheScan;
     dates = it.value().dates;
     closes = it.value().closes;
     return !closes.isEmpty() && dates.size() == closes.size();
@@ -652,8 +1493,50 @@ bool Ma5Scanner::cacheGet(const QString& secid, QVector<QString>& dates, QVector
 
 void Ma5Scanner::cachePut(const QString& secid, const QVector<QString>& dates, const QVector<double>& closes)
 {
+    auto it = m_cache.find(secid);
+    if (it == m_cache.end() && m_cacheFull) return;
+
     CacheItem ci;
     ci.dates = dates;
     ci.closes = closes;
-    m_cache.insert(secid, ci);
+    ci.fetched = QDate::currentDate();
+    ci.bytes = MemoryUsage::ofString(secid) + MemoryUsage::ofStrings(dates) + MemoryUsage::ofVector(closes);
+    ci.scan = m_cacheScan;
+    if (it != m_cache.end()) {
+        m_cacheBytes -= it->bytes;
+        *it = ci;
+    } else {
+        m_cache.insert(secid, ci);
+    }
+    m_cacheBytes += ci.bytes;
+
+    if (++m_putsSinceCheck >= kPressureCheckPuts) {
+        m_putsSinceCheck = 0;
+        m_memoryPressure = MemoryUsage::enforce();
+    }
+    trimCache();
+}
+
+qint64 Ma5Scanner::cacheLimit() const
+{
+    const qint64 limit = MemoryUsage::limits().klineCacheBytes;
+    return m_memoryPressure && limit > 0 ? limit / 2 : limit;
+}
+
+void Ma5Scanner::trimCache()
+{
+    const qint64 limit = cacheLimit();
+    if (limit <= 0 || m_cacheBytes <= limit) return;
+
+    const qint64 target = limit / 10 * 9;
+    for (auto it = m_cache.begin(); it != m_cache.end() && m_cacheBytes > target;) {
+        if (it->scan == m_cacheScan) {
+            ++it;
+            continue;
+        }
+        m_cacheBytes -= it->bytes;
+        it = m_cache.erase(it);
+    }
+    // 剩下的都是本轮用到的：保留它们，只是不再收新的
+    if (m_cacheBytes > target) m_cacheFull = true;
 }
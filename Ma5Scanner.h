@@ -1,14 +1,21 @@
 ﻿#pragma once
-#include "QuoteModel.h"
+#include "PickRow.h"
+#include "PriceBandIndex.h"
+#include "ScanMetrics.h"
 
 #include <QObject>
 #include <QVector>
-#include <QQueue>
+#include <QStringList>
 #include <QHash>
+#include <QSet>
 #include <QDate>
+#include <QElapsedTimer>
 
 class QNetworkAccessManager;
 class QNetworkReply;
+class QTimer;
+class SpotStream;
+struct KlineResult;
 
 struct Spot {
     QString code;
@@ -31,6 +38,7 @@ struct ScanConfig {
     int maxRetries = 2;
     int sortField = 0;
     bool sortDesc = true;
+    int topK = 0;           // 0 = 不限；>0 时只保留排序最靠前的 K 只（有界堆）
     enum class Provider {
         Eastmoney,
         Sina
@@ -52,6 +60,17 @@ struct KlineStats {
     double ma5Prev = 0;
     bool prevNDaysCloseBelowMA5 = false;
     bool prevNDaysCloseAboveMA5 = false;
+    int belowStreak = 0;   // 截至倒数第二根已收盘K线，连续收盘<MA5 的天数
+    int aboveStreak = 0;   // 同上，连续收盘>MA5 的天数
+};
+
+// 单只股票扫描后保留的紧凑派生状态：N / 容差 / 斜率条件变化时直接在内存里重判
+struct SymbolState {
+    Spot spot;
+    double ma5Last = 0;
+    double ma5Prev = 0;
+    int belowStreak = 0;
+    int aboveStreak = 0;
 };
 
 class Ma5Scanner : public QObject
@@ -59,24 +78,111 @@ class Ma5Scanner : public QObject
     Q_OBJECT
 public:
     explicit Ma5Scanner(QObject* parent=nullptr);
+    ~Ma5Scanner() override;
 
     void runOnce(const ScanConfig& cfg);
     void cancel();
 
+    // 断点续扫：列表拉完后每隔几秒把股票池、已完成代码和派生状态写到 AppData/checkpoints/，
+    // 取消 / 退出时再写一次，扫描完成后删除。同一交易日、同一K线源内有效，按模式各存一份。
+    // resume 恢复已完成部分的结果，只拉剩下的股票；没有可用断点时返回 false
+    bool resume(const ScanConfig& cfg);
+    static bool checkpointInfo(const ScanConfig& cfg, int* done, int* total);
+
+    // 插队：这些代码排到K线队列最前（表格里可见的行、交互查看的股票）。
+    // 列表还没拉完时先记下，排队时放进第一档；同一轮内多次调用累加
+    void prioritize(const QStringList& codes);
+
+    // 上次完整扫描留下的派生状态；参数变化时 O(symbols) 重算结果，无需重新拉取
+    bool hasStates() const { return m_statesReady; }
+    // 扫描时按缓存跳过了不可能命中的股票，它们没有状态：只有同一模式、N 不小于当时（条件不更宽）才算完整
+    bool statesCover(const ScanConfig& cfg) const;
+    QVector<PickRow> reevaluate(const ScanConfig& cfg) const;
+
+    // 盯盘：保留收盘K线派生状态，只按间隔重拉行情列表，用新价重判并推送进出
+    // 两种模式可同时盯，共用一次行情拉取；需先有一次完整扫描，且同一交易日内有效
+    // intervalMs == 0：改用东财 SSE 长连接，变化到达后约 200ms 内推送（新浪退回 5 秒轮询）
+    bool watch(const ScanConfig& cfg, int intervalMs);
+    void unwatch(ScanConfig::Mode mode);
+    void stopWatch();
+    bool isWatching(ScanConfig::Mode mode) const { return m_watches.contains(static_cast<int>(mode)); }
+
+    // 最近一次完整扫描的性能记录（直方图、计数器、时间线）
+    const ScanMetrics& metrics() const { return m_metrics; }
+
+    // 各结构的估算字节数（K线缓存、列表、队列、在途任务、结果、派生状态，
+    // 以及共享的 BarStore / 推演缓存）和进程常驻内存；扫描结束时并入报告
+    QJsonObject memoryReport() const;
+
+    static bool isBeijingCode(const QString& code);
+    static bool evaluateState(const SymbolState& st, const ScanConfig& cfg, PickRow* out);
+    static bool rankBefore(const PickRow& a, const PickRow& b, const ScanConfig& cfg);
+    static void sortRows(QVector<PickRow>& rows, const ScanConfig& cfg);
+    static bool pushTopK(QVector<PickRow>& heap, const PickRow& r, const ScanConfig& cfg, PickRow* evicted);
+
 signals:
     void stageChanged(const QString& text);
     void progress(int done, int total);
+    void rowsFound(QVector<PickRow> rows);   // 扫描中按小批量推送的命中结果
+    void rowsEvicted(QStringList codes);     // Top-K 已满时被挤出的代码
     void finished(QVector<PickRow> rows);
     void failed(const QString& reason);
     void cancelled();
+    // 扫描结束（完成 / 失败 / 取消）时发一次，先于 finished / failed；记录已写到 ScanMetrics::directory()
+    void metricsReady(QJsonObject summary);
+    // entered / exited：上次推送以来净穿越触发价格带的代码（Top-K 截断之前）
+    void watchUpdated(ScanConfig::Mode mode, QVector<PickRow> rows, QStringList entered, QStringList exited);
+    void watchStopped(const QString& reason);
 
 private:
+    friend class ScannerBench;   // bench/：直接测解析、统计和缓存读写
+
+    void abortInFlight();
+    void resetRun(const ScanConfig& cfg);
+    void beginMetrics(const QString& prefix);
+    void finishMetrics(const QString& status);
+    // 按 downloadProgress 累计响应缓冲，回调处理完后释放，得到在途缓冲峰值
+    void trackBuffer(QNetworkReply* reply);
+
+    // progress / stageChanged 按帧合并
+    void notifyProgress(int done, int total);
+    void notifyStage(const QString& text);
+    void scheduleUi();
+    void flushUi();
+
     // step1: fetch all spots
+    QNetworkReply* requestSpotPage(const ScanConfig& cfg, int pn);
+    bool parseSpotPage(const ScanConfig& cfg, const QByteArray& raw, QVector<Spot>& page, int* total) const;
     void fetchSpotPage(int pn);
 
+    // watch
+    struct WatchSlot {
+        ScanConfig cfg;
+        int intervalMs = 0;     // 0 = SSE 推送
+        PriceBandIndex bands;   // 收盘后预算的触发价格带
+        QSet<QString> entered;  // 上次推送以来的净穿越
+        QSet<QString> exited;
+    };
+    void watchTick();
+    void requestWatchPage(int pn);
+    void finishWatchTick();
+    void applyWatchSpot(const Spot& spot);
+    void restartWatchTimer();
+
     // step2: kline queue
+    // 排队顺序：插队 > 按昨日缓存预判会命中 > 离价格带不远 > 无缓存 > 预判不中或离得远；
+    // 同档内按离价格带的相对距离，再按列表顺序
+    struct QueueKey {
+        int tier = 0;
+        double distance = 0;
+    };
     void startKlineQueue();
     void pumpKline();
+    QueueKey queueKey(const Spot& s) const;
+    // 只用缓存里的收盘K线（不管缓存是哪天的）推出的派生状态；没有缓存或数据不足返回 false
+    bool cachedState(const Spot& s, SymbolState* out) const;
+    // 缓存条目不是今天拉的时：能证明按当前模式 / N 连续天数凑不够、不可能命中的，返回 true，不必拉取
+    bool pruneByCache(const Spot& s);
 
     // kline task
     struct Task {
@@ -85,10 +191,15 @@ private:
         QList<int> marketTryList;
         int marketTryIndex = 0;
         QString secidUsed; // 本次请求实际用的 secid
+        ScanMetrics::Span span;
     };
 
     void requestKlineInitial(const Spot& s);   // 入队用：创建 Task
-    void sendKlineTask(Task t);                // 真正发请求：保持 Task 状态续跑
+    void sendKlineTask(Task t);                // 真正发请求（经 KlineHub）：保持 Task 状态续跑
+    void handleKlineResult(Task t, const KlineResult& res);
+    void acceptBars(const Spot& s, const QVector<QString>& dates, const QVector<double>& closes);
+    void addState(const SymbolState& state);
+    void flushPendingRows();
 
     static QByteArray normalizeJsonMaybeJsonp(const QByteArray& body);
     static bool parseKlineBars(const QByteArray& body, const ScanConfig& cfg, QVector<QString>& dates, QVector<double>& closes);
@@ -102,8 +213,17 @@ private:
     void loadCache();
     void saveCache();
     QString cachePath() const;
-    bool cacheGet(const QString& secid, QVector<QString>& dates, QVector<double>& closes) const;
+    bool cacheGet(const QString& secid, QVector<QString>& dates, QVector<double>& closes);
     void cachePut(const QString& secid, const QVector<QString>& dates, const QVector<double>& closes);
+    // 超过软上限时先丢本轮没用到的条目，降到上限的 90%；仍超就停止缓存新条目
+    void trimCache();
+    qint64 cacheLimit() const;
+
+    // checkpoint
+    static QString checkpointPath(ScanConfig::Mode mode);
+    static bool readCheckpoint(const ScanConfig& cfg, QJsonObject* root);
+    void writeCheckpoint();
+    void disarmCheckpoint();
 
     // secid helpers
     QString secidFor(const Spot& s, int marketOverride = -1) const;
@@ -119,16 +239,71 @@ private:
     QVector<Spot> m_spots;
     int m_spotTotal = 0;
 
-    QQueue<Spot> m_queue;
+    QVector<Spot> m_queue;              // 按优先级排好，从 m_queueHead 往后取
+    int m_queueHead = 0;
+    QSet<QString> m_boosted;            // 要求插队的代码
+    int m_pruned = 0;                   // 本轮按缓存跳过的股票数
+    ScanConfig::Mode m_prunedMode = ScanConfig::Mode::BreakAboveMa5;
+    int m_prunedDays = 0;               // 跳过时证明用的 N
     int m_totalToDo = 0;   // 固定总数
     int m_done = 0;
     int m_inFlight = 0;
 
-    QHash<QNetworkReply*, Task> m_tasks;
+    QHash<quint64, Task> m_tasks;       // KlineHub 票据 -> 任务
+    QHash<QNetworkReply*, qint64> m_replyBuffered;
+    ScanMetrics m_metrics;
+    QTimer* m_lagTimer = nullptr;
+    QElapsedTimer m_lagClock;
+
+    QTimer* m_uiFlushTimer = nullptr;
+    QElapsedTimer m_uiClock;
+    bool m_stagePending = false;
+    bool m_progressPending = false;
+    QString m_pendingStage;
+    int m_pendingDone = 0;
+    int m_pendingTotal = 0;
     QVector<PickRow> m_results;
+    QVector<SymbolState> m_states;
+    bool m_statesReady = false;
+    QDate m_statesDate;                 // 状态对应的交易日（今天的K线已剔除）
+    QHash<QString, int> m_stateIndex;   // code -> m_states 下标
+
+    QHash<int, WatchSlot> m_watches;    // key: ScanConfig::Mode
+    ScanConfig m_watchFetchCfg;         // 行情拉取用（源 / 页大小 / 并发 / 超时）
+    QTimer* m_watchTimer = nullptr;
+    quint64 m_watchGen = 0;             // 每轮 +1，旧回调据此丢弃
+    QList<QNetworkReply*> m_watchReplies;
+    int m_watchNextPage = 0;
+    int m_watchLastPage = 0;            // 东财由 total 推出；新浪未知，拉到空页为止
+    bool m_watchFailed = false;
+    SpotStream* m_stream = nullptr;
+    QTimer* m_streamFlushTimer = nullptr;
+
+    // 断点：m_completed 为已拿到K线（含数据不足）的代码；失败放弃的不算，续扫时重试
+    QSet<QString> m_completed;
+    QTimer* m_checkpointTimer = nullptr;
+    bool m_checkpointArmed = false;     // 列表已拉完，断点可写
+    bool m_checkpointDirty = false;
+
+    // 流式推送：攒够一批或定时器到点就发 rowsFound
+    QVector<PickRow> m_pendingRows;
+    QStringList m_pendingEvictions;
+    QTimer* m_flushTimer = nullptr;
 
     // file cache: secid -> bars
-    QDate m_cacheDate;
-    struct CacheItem { QVector<QString> dates; QVector<double> closes; };
+    QDate m_cacheDate;                  // 缓存文件的写入日期；条目是否当天有效看 CacheItem::fetched
+    QDate m_cacheLoadedOn;              // 最近一次读文件的日期：过期的缓存一天只重读一次
+    struct CacheItem {
+        QVector<QString> dates;
+        QVector<double> closes;
+        QDate fetched;          // 这份K线是哪天拉的；只有当天拉的才能直接命中
+        qint64 bytes = 0;
+        quint32 scan = 0;       // 最近一次被用到的扫描序号
+    };
     QHash<QString, CacheItem> m_cache;
+    qint64 m_cacheBytes = 0;
+    quint32 m_cacheScan = 0;
+    bool m_cacheFull = false;           // 本轮已满：不再缓存新条目
+    bool m_memoryPressure = false;      // 进程常驻内存超限，K线缓存上限减半
+    int m_putsSinceCheck = 0;
 };
@@ -0,0 +1,144 @@
+#include "MemoryUsage.h"
+#include "BacktestCache.h"
+#include "BarStore.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QSettings>
+#include <QStandardPaths>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+QMutex g_mutex;
+bool g_loaded = false;
+MemoryUsage::Limits g_limits;
+qint64 (*g_allocationCounter)() = nullptr;      // AllocCounter.cpp 静态初始化时登记
+
+QString settingsPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/settings.ini";
+}
+
+#if defined(Q_OS_LINUX)
+// /proc/self/status 里的 "VmRSS:   12345 kB"
+qint64 procStatusKb(const char* key)
+{
+    QFile f("/proc/self/status");
+    if (!f.open(QIODevice::ReadOnly)) return -1;
+    const QByteArray prefix = QByteArray(key) + ':';
+    for (const QByteArray& line : f.readAll().split('\n')) {
+        if (!line.startsWith(prefix)) continue;
+        bool ok = false;
+        const qint64 kb = line.mid(prefix.size()).trimmed().split(' ').value(0).toLongLong(&ok);
+        return ok ? kb * 1024 : -1;
+    }
+    return -1;
+}
+#endif
+}
+
+MemoryUsage::Limits MemoryUsage::limits()
+{
+    QMutexLocker locker(&g_mutex);
+    if (!g_loaded) {
+        g_loaded = true;
+        QSettings s(settingsPath(), QSettings::IniFormat);
+        auto mb = [&s](const char* key, qint64 fallback) {
+            const QVariant v = s.value(QString("memory/%1").arg(QLatin1String(key)));
+            return v.isValid() ? qMax<qint64>(0, v.toLongLong()) << 20 : fallback;
+        };
+        const Limits d;
+        g_limits.klineCacheBytes = mb("klineCacheMB", d.klineCacheBytes);
+        g_limits.barStoreBytes = mb("barStoreMB", d.barStoreBytes);
+        g_limits.backtestCacheBytes = mb("backtestCacheMB", d.backtestCacheBytes);
+        g_limits.processBytes = mb("processMB", d.processBytes);
+    }
+    return g_limits;
+}
+
+void MemoryUsage::setLimits(const Limits& limits)
+{
+    {
+        QMutexLocker locker(&g_mutex);
+        g_loaded = true;
+        g_limits = limits;
+        QSettings s(settingsPath(), QSettings::IniFormat);
+        s.setValue("memory/klineCacheMB", limits.klineCacheBytes >> 20);
+        s.setValue("memory/barStoreMB", limits.barStoreBytes >> 20);
+        s.setValue("memory/backtestCacheMB", limits.backtestCacheBytes >> 20);
+        s.setValue("memory/processMB", limits.processBytes >> 20);
+    }
+    enforce();
+}
+
+bool MemoryUsage::enforce()
+{
+    const Limits l = limits();
+    const qint64 rss = residentBytes();
+    const bool pressure = l.processBytes > 0 && rss > l.processBytes;
+    auto target = [pressure](qint64 limit) { return pressure && limit > 0 ? limit / 2 : limit; };
+
+    BacktestCache::instance().setMemoryLimit(target(l.backtestCacheBytes));
+    BarStore::instance().trimTo(target(l.barStoreBytes));
+    return pressure;
+}
+
+qint64 MemoryUsage::residentBytes()
+{
+#if defined(Q_OS_LINUX)
+    return procStatusKb("VmRSS");
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return qint64(pmc.WorkingSetSize);
+    return -1;
+#else
+    return -1;
+#endif
+}
+
+qint64 MemoryUsage::peakResidentBytes()
+{
+#if defined(Q_OS_LINUX)
+    return procStatusKb("VmHWM");
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return qint64(pmc.PeakWorkingSetSize);
+    return -1;
+#else
+    return -1;
+#endif
+}
+
+qint64 MemoryUsage::heapInUseBytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return qint64(mallinfo2().uordblks);
+#else
+    return -1;
+#endif
+}
+
+qint64 MemoryUsage::allocationCount()
+{
+    return g_allocationCounter ? g_allocationCounter() : -1;
+}
+
+void MemoryUsage::setAllocationCounter(qint64 (*counter)())
+{
+    g_allocationCounter = counter;
+}
+
+QString MemoryUsage::formatBytes(qint64 bytes)
+{
+    if (bytes < 0) return QString("-");
+    if (bytes < 1024 * 1024) return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 0);
+    return QString("%1 MB").arg(bytes / 1048576.0, 0, 'f', 1);
+}
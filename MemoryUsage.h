@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// 内存占用估算与软上限。估算按 Qt5 容器布局（对象本身一个 d 指针，堆上 24 字节
+// QArrayData 头 + 容量），隐式共享的字符串按独占计，所以是偏大的上界。
+// 软上限读自 AppData/settings.ini 的 [memory] 节，单位 MB，0 表示不限：
+//   klineCacheMB    扫描用的当日K线缓存
+//   barStoreMB      BarStore（推演 / 图表用的日K线）
+//   backtestCacheMB 推演结果缓存
+//   processMB       进程常驻内存超过它时把上面三者再压到一半
+class MemoryUsage
+{
+public:
+    struct Limits {
+        qint64 klineCacheBytes = 64LL << 20;
+        qint64 barStoreBytes = 128LL << 20;
+        qint64 backtestCacheBytes = 32LL << 20;
+        qint64 processBytes = 0;
+    };
+
+    static constexpr qint64 kArrayHeader = 24;     // Qt5 QArrayData（64 位）
+
+    static Limits limits();
+    static void setLimits(const Limits& limits);    // 写回 settings.ini 并立即生效
+
+    // 按上限裁剪 BarStore / 推演缓存；常驻内存超限时目标减半。返回是否处于进程级压力下
+    static bool enforce();
+
+    // 进程常驻内存 / 峰值；平台不支持时返回 -1
+    static qint64 residentBytes();
+    static qint64 peakResidentBytes();
+    // 堆上在用字节（glibc mallinfo2）；不支持时返回 -1
+    static qint64 heapInUseBytes();
+    // 进程启动以来的堆分配次数；只有 CONFIG += alloc_count 编进 AllocCounter.cpp 的程序（基准测试）才有，
+    // 否则返回 -1
+    static qint64 allocationCount();
+    static void setAllocationCounter(qint64 (*counter)());
+
+    static qint64 ofString(const QString& s)
+    {
+        return qint64(sizeof(QString)) + (s.isNull() ? 0 : kArrayHeader + qint64(s.capacity() + 1) * 2);
+    }
+
+    template <typename T>
+    static qint64 ofVector(const QVector<T>& v)
+    {
+        return qint64(sizeof(v)) + (v.capacity() > 0 ? kArrayHeader + qint64(v.capacity()) * qint64(sizeof(T)) : 0);
+    }
+
+    static qint64 ofStrings(const QVector<QString>& v)
+    {
+        qint64 bytes = ofVector(v) - qint64(v.size()) * qint64(sizeof(QString));
+        for (const auto& s : v) bytes += ofString(s);
+        return bytes;
+    }
+
+    // QHash 开销的粗估：Qt5 每个节点带 next 指针和哈希值（约 16 字节），桶数组每元素约一个指针
+    static qint64 hashOverhead(int count) { return 64 + qint64(count) * 24; }
+
+    static QString formatBytes(qint64 bytes);
+};
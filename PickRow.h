@@ -0,0 +1,15 @@
+﻿#pragma once
+#include <QString>
+
+struct PickRow
+{
+    QString code;
+    QString name;
+    QString sector;
+    double pe = 0;
+    int market = 0;      // f13
+    double last = 0;     // 现价（快照）
+    double ma5 = 0;      // 最近已收盘日 MA5（rolling）
+    double biasPct = 0;  // (last/ma5-1)*100
+    int belowDays = 0;   // 你输入的 N
+};
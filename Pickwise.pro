@@ -1,48 +1,22 @@
-QT       += core gui network charts webenginewidgets webenginecore
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-CONFIG += c++11
-
-# The following define makes your compiler emit warnings if you use
-# any Qt feature that has been marked deprecated (the exact warnings
-# depend on your compiler). Please consult the documentation of the
-# deprecated API in order to know how to port your code away from it.
-DEFINES += QT_DEPRECATED_WARNINGS
-
-# You can also make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-# You can also select to disable deprecated APIs only up to a certain version of Qt.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    BacktestWidget.cpp \
-    KlineButtonDelegate.cpp \
-    KlineDialog.cpp \
-    Ma5Scanner.cpp \
-    QuoteModel.cpp \
-    main.cpp \
-    mainwindow.cpp
-
-HEADERS += \
-    BacktestWidget.h \
-    KlineButtonDelegate.h \
-    KlineDialog.h \
-    Ma5Scanner.h \
-    QuoteModel.h \
-    mainwindow.h
-
-FORMS += \
-    mainwindow.ui
-
-msvc
-{
-    QMAKE_CFLAGS += /utf-8
-    QMAKE_CXXFLAGS += /utf-8
-}
-
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
+# core：扫描 / K线仓库 / 推演（静态库）；app：桌面程序；cli：无界面扫描；service：本地结果服务；bench：基准测试；quotefeed：本地行情替身
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    core \
+    app \
+    cli \
+    service \
+    bench \
+    quotefeed
+
+core.file = core/PickwiseCore.pro
+app.file = app/PickwiseApp.pro
+cli.file = cli/PickwiseCli.pro
+service.file = service/PickwiseService.pro
+bench.file = bench/PickwiseBench.pro
+quotefeed.file = quotefeed/PickwiseQuoteFeed.pro
+
+app.depends = core
+cli.depends = core
+service.depends = core
+bench.depends = core
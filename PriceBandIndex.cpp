@@ -0,0 +1,60 @@
+#include "PriceBandIndex.h"
+#include "Ma5Scanner.h"
+
+bool PriceBandIndex::bandFor(const SymbolState& st, const ScanConfig& cfg, PriceBand* out)
+{
+    if (st.ma5Last <= 0) return false;
+    if (cfg.requireMa5SlopeUp && !(st.ma5Last > st.ma5Prev)) return false;
+
+    PriceBand band;
+    if (cfg.mode == ScanConfig::Mode::BreakAboveMa5) {
+        // streak 最多只能覆盖 n-5 根，与逐日回看 N 天 + 数据不足判否的原逻辑等价
+        if (st.belowStreak < cfg.belowDays) return false;
+        band.lo = st.ma5Last;
+        band.loInclusive = false;
+        band.unbounded = true;
+    } else {
+        if (cfg.pullbackAboveDays <= 0 || st.aboveStreak < cfg.pullbackAboveDays) return false;
+        const double tol = cfg.pullbackTolerancePct / 100.0;
+        band.lo = st.ma5Last * (1.0 - tol);
+        band.hi = st.ma5Last * (1.0 + tol);
+    }
+    if (out) *out = band;
+    return true;
+}
+
+void PriceBandIndex::build(const QVector<SymbolState>& states, const ScanConfig& cfg)
+{
+    clear();
+    for (int i = 0; i < states.size(); ++i) {
+        const SymbolState& st = states[i];
+        if (!cfg.includeBJ && Ma5Scanner::isBeijingCode(st.spot.code)) continue;
+        Entry e;
+        if (!bandFor(st, cfg, &e.band)) continue;
+        e.state = i;
+        e.inside = e.band.contains(st.spot.last);
+        if (e.inside) ++m_inside;
+        m_entries.insert(st.spot.code, e);
+    }
+}
+
+int PriceBandIndex::update(const QString& code, double price)
+{
+    auto it = m_entries.find(code);
+    if (it == m_entries.end()) return 0;
+    const bool inside = it->band.contains(price);
+    if (inside == it->inside) return 0;
+    it->inside = inside;
+    m_inside += inside ? 1 : -1;
+    return inside ? 1 : -1;
+}
+
+QVector<int> PriceBandIndex::insideStates() const
+{
+    QVector<int> out;
+    out.reserve(m_inside);
+    for (const auto& e : m_entries) {
+        if (e.inside) out.push_back(e.state);
+    }
+    return out;
+}
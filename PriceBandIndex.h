@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+struct ScanConfig;
+struct SymbolState;
+
+// 触发价格带：streak / 斜率这些前置条件只看收盘K线，收盘后就能定下来；
+// 盘中是否命中只剩“现价是否落在带内”一个判断
+struct PriceBand {
+    double lo = 0;
+    double hi = 0;
+    bool loInclusive = true;    // 突破模式要求严格高于 MA5
+    bool unbounded = false;     // 突破模式没有上沿
+
+    bool contains(double price) const
+    {
+        if (loInclusive ? price < lo : price <= lo) return false;
+        return unbounded || price <= hi;
+    }
+};
+
+// 收盘后按参数预算每只股票的价格带，不满足前置条件的直接不进索引；
+// 行情更新时按代码 O(1) 查带，记录进带 / 出带
+class PriceBandIndex
+{
+public:
+    // 前置条件不满足返回 false；与 Ma5Scanner::evaluateState 共用这一份判定
+    static bool bandFor(const SymbolState& st, const ScanConfig& cfg, PriceBand* out);
+
+    void build(const QVector<SymbolState>& states, const ScanConfig& cfg);
+    void clear() { m_entries.clear(); m_inside = 0; }
+
+    // 喂入新价：+1 进带，-1 出带，0 不变或不在索引里
+    int update(const QString& code, double price);
+
+    int size() const { return m_entries.size(); }
+    int insideCount() const { return m_inside; }
+    QVector<int> insideStates() const;      // 带内股票在 states 里的下标
+
+private:
+    struct Entry {
+        int state = -1;
+        PriceBand band;
+        bool inside = false;
+    };
+    QHash<QString, Entry> m_entries;
+    int m_inside = 0;
+};
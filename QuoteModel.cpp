@@ -2,9 +2,36 @@
 #include <algorithm>
 #include <QtMath>
 
+namespace {
+bool isTextColumn(int column) { return column >= 0 && column <= 2; }
+bool isNumericColumn(int column) { return column >= 3 && column <= 8; }
+
+const QString& textKey(const PickRow& r, int column)
+{
+    switch (column) {
+    case 1: return r.name;
+    case 2: return r.sector;
+    default: return r.code;
+    }
+}
+
+double numericKey(const PickRow& r, int column)
+{
+    switch (column) {
+    case 3: return r.pe;
+    case 4: return r.market;
+    case 5: return r.last;
+    case 6: return r.ma5;
+    case 7: return r.biasPct;
+    case 8: return r.belowDays;
+    default: return 0;
+    }
+}
+}
+
 QuoteModel::QuoteModel(QObject* parent) : QAbstractTableModel(parent) {}
 
-int QuoteModel::rowCount(const QModelIndex&) const { return m_rows.size(); }
+int QuoteModel::rowCount(const QModelIndex&) const { return m_view.size(); }
 int QuoteModel::columnCount(const QModelIndex&) const { return 10; }
 
 QVariant QuoteModel::headerData(int section, Qt::Orientation o, int role) const
@@ -30,19 +57,21 @@ QVariant QuoteModel::headerData(int section, Qt::Orientation o, int role) const
 
 QVariant QuoteModel::data(const QModelIndex& idx, int role) const
 {
-    if (!idx.isValid() || idx.row() < 0 || idx.row() >= m_rows.size()) return {};
-    const auto& r = m_rows[idx.row()];
+    if (!idx.isValid() || idx.row() < 0 || idx.row() >= m_view.size()) return {};
+    const int src = m_view[idx.row()];
+    const auto& r = m_rows[src];
+    const auto& c = m_cache[src];
 
     if (role == Qt::DisplayRole) {
         switch (idx.column()) {
         case 0: return r.code;
         case 1: return r.name;
         case 2: return r.sector;
-        case 3: return QString::number(r.pe, 'f', 2);
+        case 3: return c.peText;
         case 4: return r.market;
-        case 5: return QString::number(r.last, 'f', 3);
-        case 6: return QString::number(r.ma5, 'f', 3);
-        case 7: return QString::number(r.biasPct, 'f', 2);
+        case 5: return c.lastText;
+        case 6: return c.ma5Text;
+        case 7: return c.biasText;
         case 8: return r.belowDays;
         case 9: return "查看";
         default: return {};
@@ -54,8 +83,20 @@ QVariant QuoteModel::data(const QModelIndex& idx, int role) const
 void QuoteModel::setRows(const QVector<PickRow>& rows)
 {
     beginResetModel();
-    m_rows = rows;
+    m_rows.clear();
+    m_cache.clear();
+    m_codeIndex.clear();
+    m_dead = 0;
+    // 板块编号按本批行重建；已选的板块等它再次出现时重新对上
+    m_sectorIds.clear();
+    m_sectorNames.clear();
+    if (m_sectorFilter != -1) m_sectorFilter = -2;
+    m_rows.reserve(rows.size());
+    m_cache.reserve(rows.size());
+    for (const auto& r : rows) addRow(r);
+    rebuildView();
     endResetModel();
+    emit sectorsChanged();
 }
 
 void QuoteModel::setDaysHeaderLabel(const QString& label)
@@ -64,27 +105,242 @@ void QuoteModel::setDaysHeaderLabel(const QString& label)
     emit headerDataChanged(Qt::Horizontal, 8, 8);
 }
 
+// 入库：格式化一次显示文本 / 搜索键 / 板块编号，之后绘制只读缓存
+void QuoteModel::addRow(const PickRow& r)
+{
+    const int src = m_rows.size();
+    m_rows.push_back(r);
+
+    RowCache c;
+    c.peText = QString::number(r.pe, 'f', 2);
+    c.lastText = QString::number(r.last, 'f', 3);
+    c.ma5Text = QString::number(r.ma5, 'f', 3);
+    c.biasText = QString::number(r.biasPct, 'f', 2);
+    c.searchKey = (r.code + QLatin1Char(' ') + r.name).toLower();
+    if (!r.sector.isEmpty()) {
+        auto it = m_sectorIds.find(r.sector);
+        if (it == m_sectorIds.end()) {
+            it = m_sectorIds.insert(r.sector, m_sectorNames.size());
+            m_sectorNames.push_back(r.sector);
+            if (m_sectorFilter == -2 && r.sector == m_sectorFilterName) m_sectorFilter = it.value();
+        }
+        c.sectorId = it.value();
+    }
+    m_cache.push_back(c);
+    m_codeIndex.insert(r.code, src);
+}
+
+bool QuoteModel::acceptsRow(int src) const
+{
+    const auto& c = m_cache[src];
+    if (!c.alive) return false;
+    if (m_sectorFilter != -1 && c.sectorId != m_sectorFilter) return false;
+    return m_filterText.isEmpty() || c.searchKey.contains(m_filterText);
+}
+
+// 相同键按入库顺序，保证顺序全序、二分插入与整体排序结果一致
+bool QuoteModel::lessSource(int a, int b) const
+{
+    const bool asc = (m_sortOrder == Qt::AscendingOrder);
+    if (isTextColumn(m_sortColumn)) {
+        const int cmp = QString::compare(textKey(m_rows[a], m_sortColumn), textKey(m_rows[b], m_sortColumn));
+        if (cmp != 0) return asc ? cmp < 0 : cmp > 0;
+    } else if (isNumericColumn(m_sortColumn)) {
+        const double x = numericKey(m_rows[a], m_sortColumn);
+        const double y = numericKey(m_rows[b], m_sortColumn);
+        if (x != y) return asc ? x < y : x > y;
+    }
+    return a < b;
+}
+
+void QuoteModel::sortOrder()
+{
+    if (isNumericColumn(m_sortColumn)) {
+        // 数值列：先抽出连续的 double 键，再只排下标
+        QVector<double> keys(m_rows.size());
+        for (int i = 0; i < m_rows.size(); ++i) keys[i] = numericKey(m_rows[i], m_sortColumn);
+        const bool asc = (m_sortOrder == Qt::AscendingOrder);
+        std::sort(m_order.begin(), m_order.end(), [&](int a, int b){
+            if (keys[a] != keys[b]) return asc ? keys[a] < keys[b] : keys[a] > keys[b];
+            return a < b;
+        });
+    } else {
+        std::sort(m_order.begin(), m_order.end(), [this](int a, int b){ return lessSource(a, b); });
+    }
+}
+
+void QuoteModel::rebuildView()
+{
+    m_order.clear();
+    m_order.reserve(m_rows.size());
+    for (int i = 0; i < m_rows.size(); ++i) {
+        if (m_cache[i].alive) m_order.push_back(i);
+    }
+    sortOrder();
+
+    m_view.clear();
+    m_view.reserve(m_order.size());
+    for (int src : m_order) {
+        if (acceptsRow(src)) m_view.push_back(src);
+    }
+}
+
+QVector<PickRow> QuoteModel::visibleRows() const
+{
+    QVector<PickRow> out;
+    out.reserve(m_view.size());
+    for (int src : m_view) out.push_back(m_rows[src]);
+    return out;
+}
+
+void QuoteModel::appendRows(const QVector<PickRow>& rows)
+{
+    if (rows.isEmpty()) return;
+
+    QStringList dupes;
+    for (const auto& r : rows) {
+        if (m_codeIndex.contains(r.code)) dupes.push_back(r.code);
+    }
+    if (!dupes.isEmpty()) removeCodes(dupes);
+
+    const int sectorCount = m_sectorNames.size();
+    const auto less = [this](int a, int b){ return lessSource(a, b); };
+
+    // 新行下标最大，按 (键, 下标) 二分即可保持当前排序，不重置视图
+    for (const auto& r : rows) {
+        addRow(r);
+        const int src = m_rows.size() - 1;
+        m_order.insert(int(std::upper_bound(m_order.begin(), m_order.end(), src, less) - m_order.begin()), src);
+        if (!acceptsRow(src)) continue;
+
+        const int pos = int(std::upper_bound(m_view.begin(), m_view.end(), src, less) - m_view.begin());
+        beginInsertRows(QModelIndex(), pos, pos);
+        m_view.insert(pos, src);
+        endInsertRows();
+    }
+
+    if (m_sectorNames.size() != sectorCount) emit sectorsChanged();
+}
+
+void QuoteModel::removeCodes(const QStringList& codes)
+{
+    // 先整批打标记，再各扫一遍 m_order / m_view，整批 O(n)
+    int removed = 0;
+    for (const auto& code : codes) {
+        const auto it = m_codeIndex.find(code);
+        if (it == m_codeIndex.end()) continue;
+        m_cache[it.value()].alive = false;
+        m_codeIndex.erase(it);
+        ++removed;
+    }
+    if (removed == 0) return;
+    m_dead += removed;
+
+    const auto dead = [this](int src) { return !m_cache[src].alive; };
+    m_order.erase(std::remove_if(m_order.begin(), m_order.end(), dead), m_order.end());
+
+    // 挤出的通常是排在末尾的一段：连续就按行删除，零散的直接重置
+    int first = -1;
+    int last = -1;
+    bool contiguous = true;
+    for (int row = 0; row < m_view.size(); ++row) {
+        if (!dead(m_view[row])) continue;
+        if (first < 0) first = row;
+        else if (row != last + 1) contiguous = false;
+        last = row;
+    }
+    if (first >= 0 && contiguous) {
+        beginRemoveRows(QModelIndex(), first, last);
+        m_view.remove(first, last - first + 1);
+        endRemoveRows();
+    } else if (first >= 0) {
+        beginResetModel();
+        m_view.erase(std::remove_if(m_view.begin(), m_view.end(), dead), m_view.end());
+        endResetModel();
+    }
+
+    if (m_dead > 256 && m_dead * 2 > m_rows.size()) compact();
+}
+
+// 去掉已删除的空位并重映射下标；下标相对顺序不变，排序的平局规则和视图行号都不受影响
+void QuoteModel::compact()
+{
+    QVector<int> remap(m_rows.size(), -1);
+    int n = 0;
+    for (int i = 0; i < m_rows.size(); ++i) {
+        if (!m_cache[i].alive) continue;
+        if (n != i) {
+            m_rows[n] = std::move(m_rows[i]);
+            m_cache[n] = std::move(m_cache[i]);
+        }
+        remap[i] = n++;
+    }
+    m_rows.resize(n);
+    m_cache.resize(n);
+    for (int& src : m_order) src = remap[src];
+    for (int& src : m_view) src = remap[src];
+    for (auto it = m_codeIndex.begin(); it != m_codeIndex.end(); ++it) it.value() = remap[it.value()];
+    m_dead = 0;
+}
+
+void QuoteModel::setFilterText(const QString& text)
+{
+    const QString t = text.trimmed().toLower();
+    if (t == m_filterText) return;
+
+    // 只在已排好序的 m_order 上过一遍，不重新排序
+    beginResetModel();
+    m_filterText = t;
+    m_view.clear();
+    for (int src : m_order) {
+        if (acceptsRow(src)) m_view.push_back(src);
+    }
+    endResetModel();
+}
+
+void QuoteModel::setSectorFilter(const QString& sector)
+{
+    const int id = sector.isEmpty() ? -1 : m_sectorIds.value(sector, -2);
+    if (id == m_sectorFilter && sector == m_sectorFilterName) return;
+
+    beginResetModel();
+    m_sectorFilter = id;
+    m_sectorFilterName = sector;
+    m_view.clear();
+    for (int src : m_order) {
+        if (acceptsRow(src)) m_view.push_back(src);
+    }
+    endResetModel();
+}
+
 void QuoteModel::sort(int column, Qt::SortOrder order)
 {
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    const QModelIndexList oldPersistent = persistentIndexList();
+    QVector<int> oldSources;
+    oldSources.reserve(oldPersistent.size());
+    for (const auto& idx : oldPersistent) oldSources.push_back(m_view.value(idx.row(), -1));
+
     m_sortColumn = column;
     m_sortOrder = order;
+    sortOrder();
+    m_view.clear();
+    for (int src : m_order) {
+        if (acceptsRow(src)) m_view.push_back(src);
+    }
 
-    std::sort(m_rows.begin(), m_rows.end(), [&](const PickRow& a, const PickRow& b){
-        auto less = [&](auto x, auto y){ return (order == Qt::AscendingOrder) ? (x < y) : (x > y); };
-        switch (column) {
-        case 0: return less(a.code, b.code);
-        case 1: return less(a.name, b.name);
-        case 2: return less(a.sector, b.sector);
-        case 3: return less(a.pe, b.pe);
-        case 4: return less(a.market, b.market);
-        case 5: return less(a.last, b.last);
-        case 6: return less(a.ma5, b.ma5);
-        case 7: return less(a.biasPct, b.biasPct);
-        case 8: return less(a.belowDays, b.belowDays);
-        case 9: return false;
-        default: return false;
-        }
-    });
+    QHash<int, int> rowOf;
+    if (!oldPersistent.isEmpty()) {
+        for (int row = 0; row < m_view.size(); ++row) rowOf.insert(m_view[row], row);
+    }
+    QModelIndexList newPersistent;
+    newPersistent.reserve(oldPersistent.size());
+    for (int i = 0; i < oldPersistent.size(); ++i) {
+        const int row = rowOf.value(oldSources[i], -1);
+        newPersistent.push_back(row >= 0 ? index(row, oldPersistent[i].column()) : QModelIndex());
+    }
+    changePersistentIndexList(oldPersistent, newPersistent);
 
-    emit dataChanged(index(0,0), index(rowCount()-1, columnCount()-1));
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
 }
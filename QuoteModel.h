@@ -1,21 +1,13 @@
 ﻿#pragma once
+#include "PickRow.h"
+
 #include <QAbstractTableModel>
 #include <QVector>
 #include <QString>
+#include <QStringList>
+#include <QHash>
 
-struct PickRow
-{
-    QString code;
-    QString name;
-    QString sector;
-    double pe = 0;
-    int market = 0;      // f13
-    double last = 0;     // 现价（快照）
-    double ma5 = 0;      // 最近已收盘日 MA5（rolling）
-    double biasPct = 0;  // (last/ma5-1)*100
-    int belowDays = 0;   // 你输入的 N
-};
-
+// 行数据只追加，删除只打标记，空位过半时一次压缩；排序 / 过滤只重排 m_view 里的下标，显示文本在入库时格式化一次
 class QuoteModel : public QAbstractTableModel
 {
     Q_OBJECT
@@ -29,11 +21,51 @@ public:
     void sort(int column, Qt::SortOrder order) override;
 
     void setRows(const QVector<PickRow>& rows);
+    void appendRows(const QVector<PickRow>& rows);   // 流式追加，按当前排序插入
+    void removeCodes(const QStringList& codes);      // Top-K 挤出的行
     void setDaysHeaderLabel(const QString& label);
-    const QVector<PickRow>& rows() const { return m_rows; }
+
+    // 过滤：代码/名称子串 + 板块；空串表示不过滤
+    void setFilterText(const QString& text);
+    void setSectorFilter(const QString& sector);
+    QStringList sectors() const { return m_sectorNames; }
+
+    const PickRow& rowAt(int row) const { return m_rows[m_view[row]]; }   // 视图行 -> 行数据
+    QVector<PickRow> visibleRows() const;
+
+signals:
+    void sectorsChanged();
 
 private:
+    struct RowCache {
+        QString peText;
+        QString lastText;
+        QString ma5Text;
+        QString biasText;
+        QString searchKey;   // code + name，小写
+        int sectorId = -1;
+        bool alive = true;
+    };
+
+    void addRow(const PickRow& r);
+    bool acceptsRow(int src) const;
+    bool lessSource(int a, int b) const;
+    void sortOrder();
+    void rebuildView();
+    void compact();
+
     QVector<PickRow> m_rows;
+    QVector<RowCache> m_cache;
+    QVector<int> m_order;             // 全部有效行的下标，已按当前列排序
+    QVector<int> m_view;              // m_order 里通过过滤的子序列（可见行 -> m_rows 下标）
+    QHash<QString, int> m_codeIndex;  // code -> m_rows 下标
+    int m_dead = 0;                   // m_rows 里已删除的空位数
+    QHash<QString, int> m_sectorIds;
+    QStringList m_sectorNames;
+
+    QString m_filterText;
+    QString m_sectorFilterName;
+    int m_sectorFilter = -1;          // -1 不过滤；-2 板块尚未出现
     QString m_daysHeaderLabel = "N(收<MA5)";
     int m_sortColumn = -1;
     Qt::SortOrder m_sortOrder = Qt::DescendingOrder;
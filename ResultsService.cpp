@@ -0,0 +1,383 @@
+#include "ResultsService.h"
+#include "BarFetcher.h"
+#include "BarStore.h"
+#include "ScanJson.h"
+
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <algorithm>
+
+namespace {
+constexpr int kMaxHeaderBytes = 16 * 1024;
+
+static QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 202: return "Accepted";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 502: return "Bad Gateway";
+    default: return "Error";
+    }
+}
+}
+
+ResultsService::ResultsService(const ServiceConfig& cfg, QObject* parent)
+    : QObject(parent)
+    , m_cfg(cfg)
+{
+    m_scanner = new Ma5Scanner(this);
+    m_http = new QTcpServer(this);
+    m_ws = new QWebSocketServer("Pickwise", QWebSocketServer::NonSecureMode, this);
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(std::max(10, m_cfg.intervalSec) * 1000);
+    connect(m_timer, &QTimer::timeout, this, &ResultsService::runCycle);
+
+    connect(m_http, &QTcpServer::newConnection, this, &ResultsService::onHttpConnection);
+    connect(m_ws, &QWebSocketServer::newConnection, this, &ResultsService::onWsConnection);
+
+    connect(m_scanner, &Ma5Scanner::rowsFound, this, [this](QVector<PickRow> rows) {
+        QJsonObject msg;
+        msg.insert("type", "rows");
+        msg.insert("mode", ScanJson::modeName(m_activeMode));
+        msg.insert("rows", ScanJson::rows(rows));
+        broadcast(msg);
+    });
+    connect(m_scanner, &Ma5Scanner::rowsEvicted, this, [this](QStringList codes) {
+        QJsonObject msg;
+        msg.insert("type", "evicted");
+        msg.insert("mode", ScanJson::modeName(m_activeMode));
+        msg.insert("codes", QJsonArray::fromStringList(codes));
+        broadcast(msg);
+    });
+    connect(m_scanner, &Ma5Scanner::metricsReady, this, [this](const QJsonObject& summary) {
+        m_results[int(m_activeMode)].metrics = summary;
+    });
+    connect(m_scanner, &Ma5Scanner::finished, this, &ResultsService::finishMode);
+    connect(m_scanner, &Ma5Scanner::failed, this, [this](const QString& reason) {
+        m_results[int(m_activeMode)].error = reason;
+        QJsonObject msg;
+        msg.insert("type", "failed");
+        msg.insert("mode", ScanJson::modeName(m_activeMode));
+        msg.insert("error", reason);
+        broadcast(msg);
+        QTimer::singleShot(0, this, &ResultsService::startNextMode);
+    });
+}
+
+bool ResultsService::start(QString* error)
+{
+    // 只监听本机：服务的是同一台机器上的客户端
+    if (!m_http->listen(QHostAddress::LocalHost, m_cfg.httpPort)) {
+        if (error) *error = QString("HTTP 端口 %1 监听失败：%2").arg(m_cfg.httpPort).arg(m_http->errorString());
+        return false;
+    }
+    if (!m_ws->listen(QHostAddress::LocalHost, m_cfg.wsPort)) {
+        if (error) *error = QString("WebSocket 端口 %1 监听失败：%2").arg(m_cfg.wsPort).arg(m_ws->errorString());
+        return false;
+    }
+    m_timer->start();
+    runCycle();
+    return true;
+}
+
+void ResultsService::runCycle()
+{
+    if (m_running) return;      // 上一轮还没完，这次跳过
+    m_running = true;
+    m_cycleStartedAt = QDateTime::currentDateTime();
+    m_pendingModes = m_cfg.modes;
+    startNextMode();
+}
+
+void ResultsService::startNextMode()
+{
+    if (m_pendingModes.isEmpty()) {
+        m_running = false;
+        m_priorityCodes.clear();
+        return;
+    }
+    m_activeMode = m_pendingModes.takeFirst();
+    ScanConfig cfg = m_cfg.scan;
+    cfg.mode = m_activeMode;
+
+    QJsonObject msg;
+    msg.insert("type", "started");
+    msg.insert("mode", ScanJson::modeName(m_activeMode));
+    broadcast(msg);
+
+    m_scanner->runOnce(cfg);
+
+    // 上一轮的结果是客户端正看着的，和插队的一起先拉
+    QStringList codes = m_priorityCodes;
+    for (const auto& r : m_results.value(int(m_activeMode)).rows) codes << r.code;
+    m_scanner->prioritize(codes);
+}
+
+void ResultsService::finishMode(const QVector<PickRow>& rows)
+{
+    ModeResult& res = m_results[int(m_activeMode)];
+
+    // 与上一轮比较：新进入 / 退出的代码
+    QSet<QString> before;
+    for (const auto& r : res.rows) before.insert(r.code);
+    QSet<QString> after;
+    for (const auto& r : rows) after.insert(r.code);
+    QStringList entered;
+    for (const auto& c : after) if (!before.contains(c)) entered << c;
+    QStringList exited;
+    for (const auto& c : before) if (!after.contains(c)) exited << c;
+    const bool hadPrevious = res.finishedAt.isValid();
+
+    res.rows = rows;
+    res.finishedAt = QDateTime::currentDateTime();
+    res.error.clear();
+
+    broadcast(snapshotJson(m_activeMode));
+    if (hadPrevious) {
+        QJsonObject diff;
+        diff.insert("type", "diff");
+        diff.insert("mode", ScanJson::modeName(m_activeMode));
+        diff.insert("entered", QJsonArray::fromStringList(entered));
+        diff.insert("exited", QJsonArray::fromStringList(exited));
+        broadcast(diff);
+    }
+    // 不在扫描器的 finished 回调里重入 runOnce
+    QTimer::singleShot(0, this, &ResultsService::startNextMode);
+}
+
+// ------------------- HTTP -------------------
+void ResultsService::onHttpConnection()
+{
+    while (QTcpSocket* socket = m_http->nextPendingConnection()) {
+        m_httpBuffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onHttpReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_httpBuffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void ResultsService::onHttpReadyRead(QTcpSocket* socket)
+{
+    auto it = m_httpBuffers.find(socket);
+    if (it == m_httpBuffers.end()) return;      // 已在处理
+    it->append(socket->readAll());
+
+    const int headerEnd = it->indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (it->size() > kMaxHeaderBytes) {
+            m_httpBuffers.erase(it);
+            respond(socket, 400, QJsonObject{{"error", "请求头过大"}});
+        }
+        return;
+    }
+
+    // 只看请求行；不支持 keep-alive，一问一答后关闭
+    const QByteArray requestLine = it->left(it->indexOf("\r\n"));
+    m_httpBuffers.erase(it);
+    const QList<QByteArray> parts = requestLine.split(' ');
+    if (parts.size() < 2) {
+        respond(socket, 400, QJsonObject{{"error", "请求行无效"}});
+        return;
+    }
+    handleRequest(socket, parts[0], QString::fromUtf8(parts[1]));
+}
+
+void ResultsService::handleRequest(QTcpSocket* socket, const QByteArray& method, const QString& target)
+{
+    const QUrl url(target);
+    const QString path = url.path();
+    const QUrlQuery query(url);
+
+    if (path == "/api/scan") {
+        if (method != "POST") {
+            respond(socket, 405, QJsonObject{{"error", "请用 POST"}});
+            return;
+        }
+        const QStringList codes = query.queryItemValue("codes").split(',', Qt::SkipEmptyParts);
+        if (!codes.isEmpty()) {
+            m_priorityCodes += codes;
+            if (m_running) m_scanner->prioritize(codes);
+        }
+        const bool queued = !m_running;
+        runCycle();
+        respond(socket, 202, QJsonObject{{"started", queued}, {"status", statusJson()}});
+        return;
+    }
+    if (method != "GET") {
+        respond(socket, 405, QJsonObject{{"error", "只支持 GET"}});
+        return;
+    }
+
+    if (path == "/api/status") {
+        respond(socket, 200, statusJson());
+        return;
+    }
+    if (path == "/api/results") {
+        const QString modeText = query.queryItemValue("mode");
+        if (!modeText.isEmpty()) {
+            ScanConfig::Mode mode;
+            if (!ScanJson::parseMode(modeText, &mode)) {
+                respond(socket, 400, QJsonObject{{"error", "mode 只能是 break 或 pullback"}});
+                return;
+            }
+            respond(socket, 200, snapshotJson(mode));
+            return;
+        }
+        QJsonObject all;
+        for (auto mode : m_cfg.modes) all.insert(ScanJson::modeName(mode), snapshotJson(mode));
+        respond(socket, 200, all);
+        return;
+    }
+    if (path.startsWith("/api/bars/")) {
+        const QString code = path.mid(QString("/api/bars/").size());
+        bool ok = false;
+        int days = query.queryItemValue("days").toInt(&ok);
+        if (!ok || days <= 0) days = 250;
+        if (code.size() != 6) {
+            respond(socket, 400, QJsonObject{{"error", "代码应为 6 位"}});
+            return;
+        }
+        serveBars(socket, code, days);
+        return;
+    }
+    respond(socket, 404, QJsonObject{{"error", "未知路径"}});
+}
+
+void ResultsService::serveBars(QTcpSocket* socket, const QString& code, int days)
+{
+    auto reply = [socket, code, days](bool fetchOk, const QString& error) {
+        DailyBars bars;
+        if (!BarStore::instance().get(code, &bars)) {
+            respond(socket, 502, QJsonObject{{"error", error.isEmpty() ? QString("无K线数据") : error}});
+            return;
+        }
+        // 只回最近 days 根
+        const int from = std::max(0, bars.size() - days);
+        DailyBars tail;
+        tail.dates = bars.dates.mid(from);
+        tail.opens = bars.opens.mid(from);
+        tail.closes = bars.closes.mid(from);
+        tail.highs = bars.highs.mid(from);
+        tail.lows = bars.lows.mid(from);
+        if (bars.hasVolume()) tail.volumes = bars.volumes.mid(from);
+        QJsonObject body = ScanJson::bars(code, tail);
+        body.insert("complete", fetchOk);
+        respond(socket, 200, body);
+    };
+
+    // 覆盖到昨天就直接回；否则补缺口（自然日按 1.6 倍估交易日）
+    const QDate yesterday = QDate::currentDate().addDays(-1);
+    BarCoverage cov;
+    if (BarStore::instance().coverage(code, &cov) && cov.to >= yesterday) {
+        reply(true, QString());
+        return;
+    }
+    auto* fetcher = new BarFetcher(this);
+    connect(fetcher, &BarFetcher::finished, socket, [fetcher, reply](const QString&, bool ok, const QString& error) {
+        fetcher->deleteLater();
+        reply(ok, error);
+    });
+    connect(socket, &QObject::destroyed, fetcher, [fetcher]() { fetcher->cancel(); fetcher->deleteLater(); });
+    const QDate today = QDate::currentDate();
+    fetcher->fetch(code, today.addDays(-int(days * 1.6) - 10), today);
+}
+
+void ResultsService::respond(QTcpSocket* socket, int status, const QJsonObject& body)
+{
+    const QByteArray payload = QJsonDocument(body).toJson(QJsonDocument::Compact);
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(status) + " " + reasonPhrase(status) + "\r\n";
+    head += "Content-Type: application/json; charset=utf-8\r\n";
+    head += "Access-Control-Allow-Origin: *\r\n";
+    head += "Cache-Control: no-store\r\n";
+    head += "Connection: close\r\n";
+    head += "Content-Length: " + QByteArray::number(payload.size()) + "\r\n\r\n";
+    socket->write(head);
+    socket->write(payload);
+    socket->disconnectFromHost();
+}
+
+// ------------------- WebSocket -------------------
+void ResultsService::onWsConnection()
+{
+    while (QWebSocket* client = m_ws->nextPendingConnection()) {
+        m_clients.append(client);
+        connect(client, &QWebSocket::disconnected, this, [this, client]() {
+            m_clients.removeAll(client);
+            client->deleteLater();
+        });
+
+        // 新客户端先拿到当前全量，之后只收增量
+        QJsonObject hello = statusJson();
+        hello.insert("type", "hello");
+        hello.insert("seq", double(m_seq));
+        client->sendTextMessage(QString::fromUtf8(QJsonDocument(hello).toJson(QJsonDocument::Compact)));
+        for (auto mode : m_cfg.modes) {
+            if (!m_results.contains(int(mode))) continue;
+            QJsonObject snap = snapshotJson(mode);
+            snap.insert("seq", double(m_seq));
+            client->sendTextMessage(QString::fromUtf8(QJsonDocument(snap).toJson(QJsonDocument::Compact)));
+        }
+    }
+}
+
+void ResultsService::broadcast(QJsonObject message)
+{
+    message.insert("seq", double(++m_seq));
+    const QString text = QString::fromUtf8(QJsonDocument(message).toJson(QJsonDocument::Compact));
+    for (auto* client : m_clients) client->sendTextMessage(text);
+}
+
+QJsonObject ResultsService::statusJson() const
+{
+    QJsonObject o;
+    o.insert("running", m_running);
+    if (m_running) o.insert("activeMode", ScanJson::modeName(m_activeMode));
+    if (m_cycleStartedAt.isValid()) o.insert("cycleStartedAt", m_cycleStartedAt.toString(Qt::ISODate));
+    o.insert("intervalSec", m_cfg.intervalSec);
+    o.insert("clients", m_clients.size());
+    QJsonObject modes;
+    for (auto mode : m_cfg.modes) {
+        QJsonObject m;
+        const auto it = m_results.constFind(int(mode));
+        if (it != m_results.constEnd()) {
+            m.insert("count", it->rows.size());
+            if (it->finishedAt.isValid()) m.insert("finishedAt", it->finishedAt.toString(Qt::ISODate));
+            if (!it->error.isEmpty()) m.insert("error", it->error);
+            if (!it->metrics.isEmpty()) m.insert("metrics", it->metrics);
+        }
+        modes.insert(ScanJson::modeName(mode), m);
+    }
+    o.insert("modes", modes);
+    return o;
+}
+
+QJsonObject ResultsService::snapshotJson(ScanConfig::Mode mode) const
+{
+    QJsonObject o;
+    o.insert("type", "snapshot");
+    o.insert("mode", ScanJson::modeName(mode));
+    const auto it = m_results.constFind(int(mode));
+    if (it == m_results.constEnd()) {
+        o.insert("rows", QJsonArray());
+        return o;
+    }
+    if (it->finishedAt.isValid()) o.insert("finishedAt", it->finishedAt.toString(Qt::ISODate));
+    if (!it->error.isEmpty()) o.insert("error", it->error);
+    o.insert("rows", ScanJson::rows(it->rows));
+    return o;
+}
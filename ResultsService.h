@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Ma5Scanner.h"
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+#include <QJsonObject>
+
+class QTcpServer;
+class QTcpSocket;
+class QWebSocketServer;
+class QWebSocket;
+class QTimer;
+
+struct ServiceConfig {
+    quint16 httpPort = 8765;
+    quint16 wsPort = 8766;
+    int intervalSec = 300;      // 两轮扫描开始时间的间隔；上一轮未完成时顺延
+    QList<ScanConfig::Mode> modes = {ScanConfig::Mode::BreakAboveMa5, ScanConfig::Mode::PullbackToMa5};
+    ScanConfig scan;            // mode 字段由每轮覆盖
+};
+
+// 本地结果服务：定时跑 Ma5Scanner，一条拉取管线供任意多个本机客户端使用。
+//   HTTP  GET  /api/status            运行状态
+//   HTTP  GET  /api/results[?mode=]   最近一次完成的结果
+//   HTTP  GET  /api/bars/<code>[?days=] 日K线（BarStore，缺口现拉）
+//   HTTP  POST /api/scan[?codes=]     立即开始一轮；codes 逗号分隔，这些股票排到K线队列最前（已在跑时插队）
+//   WS    连接后先推 snapshot，之后推 started / rows / evicted / snapshot / diff / failed
+class ResultsService : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ResultsService(const ServiceConfig& cfg, QObject* parent = nullptr);
+
+    bool start(QString* error);
+    void runCycle();
+
+private:
+    struct ModeResult {
+        QVector<PickRow> rows;
+        QDateTime finishedAt;
+        QString error;
+        QJsonObject metrics;    // 该模式最近一轮的性能汇总
+    };
+
+    void startNextMode();
+    void finishMode(const QVector<PickRow>& rows);
+
+    // HTTP
+    void onHttpConnection();
+    void onHttpReadyRead(QTcpSocket* socket);
+    void handleRequest(QTcpSocket* socket, const QByteArray& method, const QString& target);
+    void serveBars(QTcpSocket* socket, const QString& code, int days);
+    static void respond(QTcpSocket* socket, int status, const QJsonObject& body);
+
+    // WebSocket
+    void onWsConnection();
+    void broadcast(QJsonObject message);
+    QJsonObject statusJson() const;
+    QJsonObject snapshotJson(ScanConfig::Mode mode) const;
+
+    ServiceConfig m_cfg;
+    Ma5Scanner* m_scanner = nullptr;
+    QTcpServer* m_http = nullptr;
+    QWebSocketServer* m_ws = nullptr;
+    QTimer* m_timer = nullptr;
+
+    QHash<QTcpSocket*, QByteArray> m_httpBuffers;
+    QList<QWebSocket*> m_clients;
+
+    QList<ScanConfig::Mode> m_pendingModes;
+    ScanConfig::Mode m_activeMode = ScanConfig::Mode::BreakAboveMa5;
+    bool m_running = false;
+    QDateTime m_cycleStartedAt;
+    QStringList m_priorityCodes;    // 本轮要求插队的代码，各模式都先拉
+    QHash<int, ModeResult> m_results;
+    quint64 m_seq = 0;          // 推送序号，客户端据此发现漏消息后改拉 HTTP
+};
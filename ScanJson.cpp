@@ -0,0 +1,93 @@
+#include "ScanJson.h"
+
+bool ScanJson::parseMode(const QString& s, ScanConfig::Mode* out)
+{
+    const QString v = s.toLower();
+    if (v == "break" || v == "breakabove") { *out = ScanConfig::Mode::BreakAboveMa5; return true; }
+    if (v == "pullback") { *out = ScanConfig::Mode::PullbackToMa5; return true; }
+    return false;
+}
+
+bool ScanJson::parseProvider(const QString& s, ScanConfig::Provider* out)
+{
+    const QString v = s.toLower();
+    if (v == "eastmoney") { *out = ScanConfig::Provider::Eastmoney; return true; }
+    if (v == "sina") { *out = ScanConfig::Provider::Sina; return true; }
+    return false;
+}
+
+QString ScanJson::modeName(ScanConfig::Mode mode)
+{
+    return mode == ScanConfig::Mode::PullbackToMa5 ? QString("pullback") : QString("break");
+}
+
+bool ScanJson::applyConfig(const QJsonObject& o, ScanConfig& cfg, QString* error)
+{
+    if (o.contains("mode") && !parseMode(o.value("mode").toString(), &cfg.mode)) {
+        if (error) *error = "mode 只能是 break 或 pullback";
+        return false;
+    }
+    if (o.contains("provider") && !parseProvider(o.value("provider").toString(), &cfg.provider)) {
+        if (error) *error = "provider 只能是 eastmoney 或 sina";
+        return false;
+    }
+    cfg.belowDays = o.value("belowDays").toInt(cfg.belowDays);
+    cfg.includeBJ = o.value("includeBJ").toBool(cfg.includeBJ);
+    cfg.requireMa5SlopeUp = o.value("requireMa5SlopeUp").toBool(cfg.requireMa5SlopeUp);
+    cfg.pullbackAboveDays = o.value("pullbackAboveDays").toInt(cfg.pullbackAboveDays);
+    cfg.pullbackTolerancePct = o.value("pullbackTolerancePct").toDouble(cfg.pullbackTolerancePct);
+    cfg.pageSize = o.value("pageSize").toInt(cfg.pageSize);
+    cfg.maxInFlight = o.value("maxInFlight").toInt(cfg.maxInFlight);
+    cfg.timeoutMs = o.value("timeoutMs").toInt(cfg.timeoutMs);
+    cfg.maxRetries = o.value("maxRetries").toInt(cfg.maxRetries);
+    cfg.sortField = o.value("sortField").toInt(cfg.sortField);
+    cfg.sortDesc = o.value("sortDesc").toBool(cfg.sortDesc);
+    cfg.topK = o.value("topK").toInt(cfg.topK);
+    cfg.spotBaseUrl = o.value("spotBaseUrl").toString(cfg.spotBaseUrl);
+    cfg.klineBaseUrl = o.value("klineBaseUrl").toString(cfg.klineBaseUrl);
+    return true;
+}
+
+QJsonObject ScanJson::row(const PickRow& r)
+{
+    QJsonObject o;
+    o.insert("code", r.code);
+    o.insert("name", r.name);
+    o.insert("sector", r.sector);
+    o.insert("pe", r.pe);
+    o.insert("market", r.market);
+    o.insert("last", r.last);
+    o.insert("ma5", r.ma5);
+    o.insert("biasPct", r.biasPct);
+    o.insert("days", r.belowDays);
+    return o;
+}
+
+QJsonArray ScanJson::rows(const QVector<PickRow>& rows)
+{
+    QJsonArray arr;
+    for (const auto& r : rows) arr.append(row(r));
+    return arr;
+}
+
+QJsonObject ScanJson::bars(const QString& code, const DailyBars& bars)
+{
+    QJsonArray jd, jo, jc, jh, jl, jv;
+    for (int i = 0; i < bars.size(); ++i) {
+        jd.append(bars.dates[i].toString(Qt::ISODate));
+        jo.append(bars.opens[i]);
+        jc.append(bars.closes[i]);
+        jh.append(bars.highs[i]);
+        jl.append(bars.lows[i]);
+        if (bars.hasVolume()) jv.append(bars.volumes[i]);
+    }
+    QJsonObject o;
+    o.insert("code", code);
+    o.insert("dates", jd);
+    o.insert("open", jo);
+    o.insert("close", jc);
+    o.insert("high", jh);
+    o.insert("low", jl);
+    if (bars.hasVolume()) o.insert("volume", jv);
+    return o;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Ma5Scanner.h"
+#include "BarStore.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+
+// ScanConfig / 结果 / K线 与 JSON 互转：CLI、本地服务共用同一套键名
+class ScanJson
+{
+public:
+    // 只覆盖 JSON 里出现的字段；mode / provider 取值非法时返回 false
+    static bool applyConfig(const QJsonObject& o, ScanConfig& cfg, QString* error);
+    static bool parseMode(const QString& s, ScanConfig::Mode* out);
+    static bool parseProvider(const QString& s, ScanConfig::Provider* out);
+    static QString modeName(ScanConfig::Mode mode);
+
+    static QJsonObject row(const PickRow& r);
+    static QJsonArray rows(const QVector<PickRow>& rows);
+    static QJsonObject bars(const QString& code, const DailyBars& bars);
+};
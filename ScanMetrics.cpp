@@ -0,0 +1,405 @@
+#include "ScanMetrics.h"
+#include "MemoryUsage.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtAlgorithms>
+#include <QtMath>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+const int kSubBits = 5;
+const int kSubCount = 1 << kSubBits;
+const qint64 kMaxTrackableUs = (qint64(1) << 36) - 1;   // 约 19 小时
+const int kMaxTraceEvents = 200000;
+const qint64 kStallUs = 50000;
+
+double toMs(qint64 us) { return double(us) / 1000.0; }
+
+double round2(double v) { return qRound64(v * 100.0) / 100.0; }
+}
+
+// ------------------- histogram -------------------
+int LatencyHistogram::bucketOf(qint64 us)
+{
+    const quint64 v = quint64(qBound<qint64>(0, us, kMaxTrackableUs));
+    if (v < quint64(kSubCount)) return int(v);
+    const int msb = 63 - qCountLeadingZeroBits(v);
+    const int shift = msb - kSubBits;
+    return (shift + 1) * kSubCount + int((v >> shift) & (kSubCount - 1));
+}
+
+qint64 LatencyHistogram::bucketMid(int index)
+{
+    if (index < kSubCount) return index;
+    const int shift = index / kSubCount - 1;
+    const qint64 lower = qint64(kSubCount + index % kSubCount) << shift;
+    return lower + ((qint64(1) << shift) >> 1);
+}
+
+void LatencyHistogram::record(qint64 us)
+{
+    if (us < 0) us = 0;
+    const int idx = bucketOf(us);
+    if (idx >= m_buckets.size()) m_buckets.resize(idx + 1);
+    ++m_buckets[idx];
+    if (m_count == 0 || us < m_min) m_min = us;
+    if (us > m_max) m_max = us;
+    m_sum += us;
+    ++m_count;
+}
+
+void LatencyHistogram::clear()
+{
+    m_buckets.clear();
+    m_count = 0;
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+    if (m_count == 0) return 0;
+    const quint64 rank = qMax<quint64>(1, quint64(qCeil(p / 100.0 * double(m_count))));
+    quint64 seen = 0;
+    for (int i = 0; i < m_buckets.size(); ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) return qBound(m_min, bucketMid(i), m_max);
+    }
+    return m_max;
+}
+
+QJsonObject LatencyHistogram::toJson() const
+{
+    return QJsonObject{
+        {"count", double(m_count)},
+        {"minMs", round2(toMs(min()))},
+        {"meanMs", round2(mean() / 1000.0)},
+        {"p50Ms", round2(toMs(percentile(50)))},
+        {"p90Ms", round2(toMs(percentile(90)))},
+        {"p99Ms", round2(toMs(percentile(99)))},
+        {"p999Ms", round2(toMs(percentile(99.9)))},
+        {"maxMs", round2(toMs(m_max))},
+    };
+}
+
+// ------------------- scan metrics -------------------
+void ScanMetrics::begin(const QString& label)
+{
+    m_active = true;
+    ++m_run;
+    m_clock.start();
+    m_startedAt = QDateTime::currentDateTime();
+    m_label = label;
+    m_summary = QJsonObject();
+
+    m_spot.clear();
+    m_klineByHost.clear();
+    m_parse.clear();
+    m_compute.clear();
+    m_loopLag.clear();
+    m_stalls = 0;
+    m_blockedUs = 0;
+    std::fill(std::begin(m_counters), std::end(m_counters), 0);
+    m_firstResultUs = -1;
+
+    m_inFlight = 0;
+    m_maxInFlight = 0;
+    m_inFlightSince = 0;
+    m_inFlightArea = 0;
+    m_lanes.clear();
+
+    m_buffered = 0;
+    m_peakBuffered = 0;
+    m_allocsAtStart = MemoryUsage::allocationCount();
+    m_heapAtStart = MemoryUsage::heapInUseBytes();
+    m_memory = QJsonObject();
+
+    m_trace.clear();
+    m_traceDropped = 0;
+}
+
+void ScanMetrics::bufferDelta(qint64 delta)
+{
+    if (!m_active) return;
+    m_buffered = qMax<qint64>(0, m_buffered + delta);
+    m_peakBuffered = qMax(m_peakBuffered, m_buffered);
+}
+
+void ScanMetrics::setInFlight(int n, qint64 now)
+{
+    m_inFlightArea += double(m_inFlight) * double(now - m_inFlightSince);
+    m_inFlightSince = now;
+    m_inFlight = n;
+    m_maxInFlight = qMax(m_maxInFlight, n);
+}
+
+ScanMetrics::Span ScanMetrics::beginRequest()
+{
+    Span span;
+    if (!m_active) return span;
+    span.startUs = nowUs();
+    span.run = m_run;
+    span.lane = int(m_lanes.indexOf(false));
+    if (span.lane < 0) {
+        span.lane = m_lanes.size();
+        m_lanes.push_back(true);
+    } else {
+        m_lanes[span.lane] = true;
+    }
+    m_counters[Requests] += 1;
+    setInFlight(m_inFlight + 1, span.startUs);
+    return span;
+}
+
+void ScanMetrics::endRequest(const Span& span, const char* kind, const QString& host, qint64 bytes, bool ok, const QString& detail)
+{
+    if (!m_active || span.startUs < 0 || span.run != m_run) return;
+    const qint64 now = nowUs();
+    const qint64 dur = now - span.startUs;
+    if (span.lane >= 0 && span.lane < m_lanes.size()) m_lanes[span.lane] = false;
+    setInFlight(qMax(0, m_inFlight - 1), now);
+
+    m_counters[BytesReceived] += bytes;
+    if (!ok) m_counters[Failures] += 1;
+    if (qstrcmp(kind, "spot") == 0) m_spot.record(dur);
+    else m_klineByHost[host].record(dur);
+
+    trace(QString("%1 %2").arg(QLatin1String(kind), detail), kind, span.startUs, dur, span.lane + 1,
+          ok ? host : QString("%1 失败").arg(host));
+}
+
+void ScanMetrics::recordParse(qint64 startUs, const char* what)
+{
+    if (!m_active) return;
+    const qint64 dur = nowUs() - startUs;
+    m_parse[QLatin1String(what)].record(dur);
+    trace(QString("parse %1").arg(QLatin1String(what)), "parse", startUs, dur, 0);
+}
+
+void ScanMetrics::recordCompute(qint64 startUs)
+{
+    if (!m_active) return;
+    const qint64 dur = nowUs() - startUs;
+    m_compute.record(dur);
+    trace("compute", "compute", startUs, dur, 0);
+}
+
+void ScanMetrics::recordLoopLag(qint64 lagUs)
+{
+    if (!m_active) return;
+    lagUs = qMax<qint64>(0, lagUs);
+    m_loopLag.record(lagUs);
+    if (lagUs < kStallUs) return;
+    ++m_stalls;
+    m_blockedUs += lagUs;
+    trace("event loop blocked", "lag", nowUs() - lagUs, lagUs, 0);
+}
+
+void ScanMetrics::mark(const QString& name)
+{
+    if (!m_active) return;
+    trace(name, "stage", nowUs(), -1, 0);
+}
+
+void ScanMetrics::firstResult()
+{
+    if (!m_active || m_firstResultUs >= 0) return;
+    m_firstResultUs = nowUs();
+    mark("首个命中");
+}
+
+void ScanMetrics::trace(const QString& name, const char* cat, qint64 ts, qint64 dur, int tid, const QString& detail)
+{
+    if (m_trace.size() >= kMaxTraceEvents) {
+        ++m_traceDropped;
+        return;
+    }
+    m_trace.push_back(TraceEvent{name, cat, ts, dur, tid, detail});
+}
+
+QJsonObject ScanMetrics::finish(const QString& status, int results)
+{
+    if (!m_active) return m_summary;
+    const qint64 end = nowUs();
+    setInFlight(m_inFlight, end);
+    mark(QString("结束：%1").arg(status));
+    m_active = false;
+
+    QJsonObject kline;
+    for (auto it = m_klineByHost.begin(); it != m_klineByHost.end(); ++it) kline.insert(it.key(), it->toJson());
+    QJsonObject parse;
+    for (auto it = m_parse.begin(); it != m_parse.end(); ++it) parse.insert(it.key(), it->toJson());
+
+    QJsonObject counters{
+        {"requests", double(m_counters[Requests])},
+        {"cacheHits", double(m_counters[CacheHits])},
+        {"marketFallbacks", double(m_counters[MarketFallbacks])},
+        {"retries", double(m_counters[Retries])},
+        {"failures", double(m_counters[Failures])},
+        {"bytesReceived", double(m_counters[BytesReceived])},
+        {"sharedFetches", double(m_counters[SharedFetches])},
+        {"prioritized", double(m_counters[Prioritized])},
+        {"prunedFetches", double(m_counters[PrunedFetches])},
+    };
+    QJsonObject loopLag = m_loopLag.toJson();
+    loopLag.insert("stalls", m_stalls);
+    loopLag.insert("blockedMs", round2(toMs(m_blockedUs)));
+
+    QJsonObject inFlight{
+        {"max", m_maxInFlight},
+        {"mean", end > 0 ? round2(m_inFlightArea / double(end)) : 0.0},
+        {"lanes", int(m_lanes.size())},
+    };
+
+    QJsonObject memory = m_memory;
+    memory.insert("peakInFlightBufferBytes", double(m_peakBuffered));
+    const qint64 allocs = MemoryUsage::allocationCount();
+    if (allocs >= 0 && m_allocsAtStart >= 0) memory.insert("allocations", double(allocs - m_allocsAtStart));
+    const qint64 heap = MemoryUsage::heapInUseBytes();
+    if (heap >= 0 && m_heapAtStart >= 0) memory.insert("heapGrowthBytes", double(heap - m_heapAtStart));
+
+    m_summary = QJsonObject{
+        {"label", m_label},
+        {"startedAt", m_startedAt.toString(Qt::ISODateWithMs)},
+        {"status", status},
+        {"results", results},
+        {"elapsedMs", round2(toMs(end))},
+        {"firstResultMs", m_firstResultUs >= 0 ? round2(toMs(m_firstResultUs)) : -1.0},
+        {"spotPage", m_spot.toJson()},
+        {"klineByHost", kline},
+        {"parse", parse},
+        {"compute", m_compute.toJson()},
+        {"counters", counters},
+        {"inFlight", inFlight},
+        {"loopLag", loopLag},
+        {"memory", memory},
+        {"traceEvents", int(m_trace.size())},
+        {"traceDropped", m_traceDropped},
+    };
+    return m_summary;
+}
+
+QByteArray ScanMetrics::chromeTrace() const
+{
+    QJsonArray events;
+    // 泳道命名：0 为主线程上的解析 / 计算，其余为并发请求
+    int maxTid = 0;
+    for (const auto& e : m_trace) maxTid = qMax(maxTid, e.tid);
+    for (int tid = 0; tid <= maxTid; ++tid) {
+        events.push_back(QJsonObject{
+            {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", tid},
+            {"args", QJsonObject{{"name", tid == 0 ? QString("main") : QString("request %1").arg(tid)}}},
+        });
+    }
+    for (const auto& e : m_trace) {
+        QJsonObject o{
+            {"name", e.name},
+            {"cat", QLatin1String(e.cat)},
+            {"ts", double(e.ts)},
+            {"pid", 1},
+            {"tid", e.tid},
+        };
+        if (e.dur >= 0) {
+            o.insert("ph", "X");
+            o.insert("dur", double(e.dur));
+        } else {
+            o.insert("ph", "i");
+            o.insert("s", "g");
+        }
+        if (!e.detail.isEmpty()) o.insert("args", QJsonObject{{"detail", e.detail}});
+        events.push_back(o);
+    }
+    const QJsonObject root{
+        {"traceEvents", events},
+        {"displayTimeUnit", "ms"},
+        {"otherData", m_summary},
+    };
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+QString ScanMetrics::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/metrics";
+}
+
+QString ScanMetrics::save(int keepRuns) const
+{
+    const QString dir = directory();
+    QDir().mkpath(dir);
+    const QString base = dir + "/scan-" + m_startedAt.toString("yyyyMMdd-HHmmss-zzz");
+
+    QSaveFile summary(base + ".json");
+    if (!summary.open(QIODevice::WriteOnly)) return QString();
+    summary.write(QJsonDocument(m_summary).toJson(QJsonDocument::Indented));
+    if (!summary.commit()) return QString();
+
+    QSaveFile trace(base + ".trace.json");
+    if (trace.open(QIODevice::WriteOnly)) {
+        trace.write(chromeTrace());
+        trace.commit();
+    }
+
+    // 文件名带时间戳，按名字排序即按时间；多出的旧记录连同时间线一起删
+    const QStringList runs = QDir(dir).entryList({"scan-*.json"}, QDir::Files, QDir::Name)
+                                 .filter(QRegularExpression("^scan-[0-9-]+\\.json$"));
+    for (int i = 0; i + keepRuns < runs.size(); ++i) {
+        QFile::remove(dir + "/" + runs[i]);
+        QFile::remove(dir + "/" + QFileInfo(runs[i]).completeBaseName() + ".trace.json");
+    }
+    return base + ".json";
+}
+
+QString ScanMetrics::describe(const QJsonObject& summary)
+{
+    const auto spot = summary.value("spotPage").toObject();
+    const auto counters = summary.value("counters").toObject();
+    const auto inFlight = summary.value("inFlight").toObject();
+    const auto loopLag = summary.value("loopLag").toObject();
+    const auto memory = summary.value("memory").toObject();
+
+    QStringList parts;
+    parts << QString("用时 %1 s").arg(summary.value("elapsedMs").toDouble() / 1000.0, 0, 'f', 1);
+    if (summary.value("firstResultMs").toDouble() >= 0)
+        parts << QString("首个命中 %1 s").arg(summary.value("firstResultMs").toDouble() / 1000.0, 0, 'f', 1);
+    if (spot.value("count").toDouble() > 0)
+        parts << QString("列表 p50 %1 ms").arg(spot.value("p50Ms").toDouble(), 0, 'f', 0);
+    const auto hosts = summary.value("klineByHost").toObject();
+    for (auto it = hosts.begin(); it != hosts.end(); ++it) {
+        const auto h = it.value().toObject();
+        parts << QString("K线[%1] p50 %2 / p99 %3 ms")
+                     .arg(it.key())
+                     .arg(h.value("p50Ms").toDouble(), 0, 'f', 0)
+                     .arg(h.value("p99Ms").toDouble(), 0, 'f', 0);
+    }
+    parts << QString("缓存命中 %1").arg(counters.value("cacheHits").toDouble(), 0, 'f', 0)
+          << QString("换市场 %1").arg(counters.value("marketFallbacks").toDouble(), 0, 'f', 0)
+          << QString("重试 %1").arg(counters.value("retries").toDouble(), 0, 'f', 0)
+          << QString("收 %1 MB").arg(counters.value("bytesReceived").toDouble() / 1048576.0, 0, 'f', 1)
+          << QString("共享请求 %1").arg(counters.value("sharedFetches").toDouble(), 0, 'f', 0)
+          << QString("按缓存省去请求 %1").arg(counters.value("prunedFetches").toDouble(), 0, 'f', 0)
+          << QString("并发均值 %1 / 峰值 %2").arg(inFlight.value("mean").toDouble(), 0, 'f', 1)
+                                             .arg(inFlight.value("max").toInt());
+    if (loopLag.value("count").toDouble() > 0) {
+        parts << QString("事件循环最长阻塞 %1 ms，卡顿(>50ms) %2 次")
+                     .arg(loopLag.value("maxMs").toDouble(), 0, 'f', 0)
+                     .arg(loopLag.value("stalls").toInt());
+    }
+    if (memory.contains("rss")) {
+        parts << QString("内存 %1（K线缓存 %2，在途缓冲峰值 %3）")
+                     .arg(MemoryUsage::formatBytes(qint64(memory.value("rss").toDouble())))
+                     .arg(MemoryUsage::formatBytes(qint64(memory.value("klineCache").toDouble())))
+                     .arg(MemoryUsage::formatBytes(qint64(memory.value("peakInFlightBufferBytes").toDouble())));
+    }
+    if (memory.contains("allocations"))
+        parts << QString("分配 %1 次").arg(memory.value("allocations").toDouble(), 0, 'f', 0);
+    return parts.join(" · ");
+}
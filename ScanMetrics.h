@@ -0,0 +1,138 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+// HDR 风格的对数-线性直方图：每个 2 的幂区间再均分 32 格，相对误差 ≤ 1/32；
+// 单位微秒，记录 O(1)，分位数按格估计
+class LatencyHistogram
+{
+public:
+    void record(qint64 us);
+    void clear();
+
+    quint64 count() const { return m_count; }
+    qint64 min() const { return m_count ? m_min : 0; }
+    qint64 max() const { return m_max; }
+    double mean() const { return m_count ? double(m_sum) / double(m_count) : 0.0; }
+    qint64 percentile(double p) const;
+
+    // {count, minMs, meanMs, p50Ms, p90Ms, p99Ms, p999Ms, maxMs}
+    QJsonObject toJson() const;
+
+private:
+    static int bucketOf(qint64 us);
+    static qint64 bucketMid(int index);
+
+    QVector<quint64> m_buckets;
+    quint64 m_count = 0;
+    qint64 m_sum = 0;
+    qint64 m_min = 0;
+    qint64 m_max = 0;
+};
+
+// 一次扫描的性能记录：分阶段延迟直方图、计数器、并发占用，以及可导出为
+// Chrome trace-event（chrome://tracing / Perfetto）的时间线
+class ScanMetrics
+{
+public:
+    enum Counter {
+        Requests,
+        CacheHits,
+        MarketFallbacks,
+        Retries,
+        Failures,
+        BytesReceived,
+        SharedFetches,      // 与别的请求共用一次响应（KlineHub 合并）
+        Prioritized,        // 交互插队的股票数
+        PrunedFetches,      // 按昨日缓存证明不可能命中、省掉的请求
+        CounterCount
+    };
+
+    struct Span {
+        qint64 startUs = -1;
+        int lane = -1;          // 时间线上的泳道，同一时刻在途的请求各占一条
+        quint32 run = 0;        // 上一轮被中止的请求回来时据此丢弃
+    };
+
+    void begin(const QString& label);
+    bool isActive() const { return m_active; }
+    qint64 nowUs() const { return m_active ? m_clock.nsecsElapsed() / 1000 : 0; }
+
+    Span beginRequest();
+    void endRequest(const Span& span, const char* kind, const QString& host, qint64 bytes, bool ok, const QString& detail);
+    void recordParse(qint64 startUs, const char* what);
+    void recordCompute(qint64 startUs);
+    // 事件循环探针：本该醒来时刻之后又等了多久；超过 50ms 记为一次卡顿并画进时间线
+    void recordLoopLag(qint64 lagUs);
+    void add(Counter c, qint64 n = 1) { m_counters[c] += n; }
+    // 在途响应缓冲的字节数：收到数据时加、处理完释放时减，记峰值
+    void bufferDelta(qint64 delta);
+    // 收尾前挂上各结构的内存占用（Ma5Scanner::memoryReport），并入汇总的 memory 节
+    void setMemory(const QJsonObject& memory) { m_memory = memory; }
+    void mark(const QString& name);
+    // 第一只命中推给界面的时刻；只记第一次
+    void firstResult();
+
+    // 收尾并生成汇总；之后的记录被忽略，直到下一次 begin
+    QJsonObject finish(const QString& status, int results);
+    QJsonObject summary() const { return m_summary; }
+    QByteArray chromeTrace() const;
+
+    // 汇总和时间线写到 AppData/metrics/，只保留最近 keepRuns 次；返回汇总文件路径
+    QString save(int keepRuns = 30) const;
+    static QString directory();
+
+    // 一行中文摘要，给状态栏 / 日志
+    static QString describe(const QJsonObject& summary);
+
+private:
+    void setInFlight(int n, qint64 now);
+    void trace(const QString& name, const char* cat, qint64 ts, qint64 dur, int tid, const QString& detail = QString());
+
+    struct TraceEvent {
+        QString name;
+        const char* cat = "";
+        qint64 ts = 0;
+        qint64 dur = 0;     // < 0：瞬时事件
+        int tid = 0;
+        QString detail;
+    };
+
+    bool m_active = false;
+    quint32 m_run = 0;
+    QElapsedTimer m_clock;
+    QDateTime m_startedAt;
+    QString m_label;
+    QJsonObject m_summary;
+
+    LatencyHistogram m_spot;
+    QMap<QString, LatencyHistogram> m_klineByHost;
+    QMap<QString, LatencyHistogram> m_parse;    // spot / kline
+    LatencyHistogram m_compute;
+    LatencyHistogram m_loopLag;
+    int m_stalls = 0;
+    qint64 m_blockedUs = 0;
+    qint64 m_counters[CounterCount] = {};
+    qint64 m_firstResultUs = -1;
+
+    int m_inFlight = 0;
+    int m_maxInFlight = 0;
+    qint64 m_inFlightSince = 0;
+    double m_inFlightArea = 0;      // Σ 在途数 × 时长，求时间加权平均
+    QVector<bool> m_lanes;
+
+    qint64 m_buffered = 0;
+    qint64 m_peakBuffered = 0;
+    qint64 m_allocsAtStart = -1;
+    qint64 m_heapAtStart = -1;
+    QJsonObject m_memory;
+
+    QVector<TraceEvent> m_trace;
+    int m_traceDropped = 0;
+};
@@ -0,0 +1,239 @@
+#include "SpotStream.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+
+namespace {
+static const char* kEM_UT = "fa5fd1943c7b386f172d6893dbfba10b";
+static const int kMinBackoffMs = 1000;
+static const int kMaxBackoffMs = 30000;
+static const int kIdleTimeoutMs = 60000;
+static const int kStreamPageSize = 10000;   // 一条连接订阅全市场
+
+// fltt=2 时数值字段直接是数字，停牌等为 "-"
+static bool numberField(const QJsonObject& o, const char* key, double* out)
+{
+    const auto v = o.value(QLatin1String(key));
+    if (!v.isDouble()) return false;
+    *out = v.toDouble();
+    return true;
+}
+}
+
+SpotStream::SpotStream(QObject* parent) : QObject(parent)
+{
+    m_nam = new QNetworkAccessManager(this);
+
+    m_reconnectTimer = new QTimer(this);
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &SpotStream::connectStream);
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(kIdleTimeoutMs);
+    connect(m_idleTimer, &QTimer::timeout, this, [this]() {
+        if (m_reply) m_reply->abort();      // onFinished 负责重连
+    });
+}
+
+QString SpotStream::streamUrlFor(const QString& spotBaseUrl)
+{
+    QString url = spotBaseUrl;
+    if (url.endsWith("/clist/get")) url.replace(url.size() - 3, 3, "sse");
+    return url;
+}
+
+void SpotStream::start(const ScanConfig& cfg)
+{
+    // 已在跑：地址没变就沿用当前连接，换了源 / 地址则断开重连
+    const bool sameEndpoint = cfg.provider == m_cfg.provider
+        && streamUrlFor(cfg.spotBaseUrl) == streamUrlFor(m_cfg.spotBaseUrl);
+    if (m_running && sameEndpoint) {
+        m_cfg = cfg;
+        return;
+    }
+    if (m_running) stop();
+    m_cfg = cfg;
+    m_running = true;
+    m_backoffMs = 0;
+    connectStream();
+}
+
+void SpotStream::stop()
+{
+    m_running = false;
+    m_reconnectTimer->stop();
+    m_idleTimer->stop();
+    if (m_reply) {
+        QNetworkReply* reply = m_reply;
+        m_reply = nullptr;
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+    m_buffer.clear();
+    m_eventData.clear();
+}
+
+void SpotStream::connectStream()
+{
+    if (!m_running || m_reply) return;
+
+    QUrl url(streamUrlFor(m_cfg.spotBaseUrl));
+    QUrlQuery q;
+    q.addQueryItem("pn", "1");
+    q.addQueryItem("pz", QString::number(kStreamPageSize));
+    q.addQueryItem("po", "0");
+    q.addQueryItem("np", "2");
+    q.addQueryItem("fltt", "2");
+    q.addQueryItem("invt", "2");
+    q.addQueryItem("fid", "f12");
+    q.addQueryItem("ut", kEM_UT);
+    q.addQueryItem("fs", "m:0+t:6,m:0+t:80,m:1+t:2,m:1+t:23,m:0+t:81+s:2048");
+    q.addQueryItem("fields", "f12,f14,f2,f13,f9,f100");
+    url.setQuery(q);
+
+    QNetworkRequest req(url);
+    req.setRawHeader("User-Agent", "Mozilla/5.0");
+    req.setRawHeader("Accept", "text/event-stream");
+    req.setRawHeader("Cache-Control", "no-cache");
+    req.setRawHeader("Referer", "https://quote.eastmoney.com/");
+    req.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+
+    m_buffer.clear();
+    m_eventData.clear();
+    m_gotData = false;
+
+    m_reply = m_nam->get(req);
+    connect(m_reply, &QNetworkReply::readyRead, this, &SpotStream::onReadyRead);
+    connect(m_reply, &QNetworkReply::finished, this, &SpotStream::onFinished);
+    m_idleTimer->start();
+}
+
+void SpotStream::onReadyRead()
+{
+    if (!m_reply) return;
+    m_idleTimer->start();
+    m_buffer += m_reply->readAll();
+
+    // 按行切：空行结束一个事件
+    int start = 0;
+    for (;;) {
+        const int nl = m_buffer.indexOf('\n', start);
+        if (nl < 0) break;
+        QByteArray line = m_buffer.mid(start, nl - start);
+        start = nl + 1;
+        if (line.endsWith('\r')) line.chop(1);
+
+        if (line.isEmpty()) {
+            dispatchEvent();
+        } else if (line.startsWith(':')) {
+            // 注释 / 心跳
+        } else if (line.startsWith("data:")) {
+            QByteArray value = line.mid(5);
+            if (value.startsWith(' ')) value.remove(0, 1);
+            if (!m_eventData.isEmpty()) m_eventData += '\n';
+            m_eventData += value;
+        } else if (line.startsWith("retry:")) {
+            bool ok = false;
+            const int ms = line.mid(6).trimmed().toInt(&ok);
+            if (ok && ms > 0) m_serverRetryMs = ms;
+        }
+    }
+    m_buffer.remove(0, start);
+}
+
+void SpotStream::dispatchEvent()
+{
+    if (m_eventData.isEmpty()) return;
+    const QByteArray data = m_eventData;
+    m_eventData.clear();
+
+    const QVector<Spot> changed = applyMessage(data);
+    if (!m_gotData) {
+        m_gotData = true;
+        m_backoffMs = 0;
+        emit connected();
+    }
+    if (!changed.isEmpty()) emit spotsChanged(changed);
+}
+
+void SpotStream::onFinished()
+{
+    QNetworkReply* reply = m_reply;
+    m_reply = nullptr;
+    m_idleTimer->stop();
+    if (!reply) return;
+
+    const QString reason = reply->error() == QNetworkReply::NoError ? QString("服务端关闭连接")
+                                                                    : reply->errorString();
+    reply->deleteLater();
+    if (m_running) scheduleReconnect(reason);
+}
+
+void SpotStream::scheduleReconnect(const QString& reason)
+{
+    // 收到过数据的连接断了就从最短间隔重来，否则指数退避
+    m_backoffMs = m_gotData ? kMinBackoffMs : qBound(kMinBackoffMs, m_backoffMs * 2, kMaxBackoffMs);
+    const int delay = qMax(m_backoffMs, m_serverRetryMs);
+    emit disconnected(reason);
+    m_reconnectTimer->start(delay);
+}
+
+QVector<Spot> SpotStream::applyMessage(const QByteArray& json)
+{
+    QVector<Spot> changed;
+    const auto doc = QJsonDocument::fromJson(json);
+    if (!doc.isObject()) return changed;
+
+    const auto data = doc.object().value("data").toObject();
+    const auto diffVal = data.value("diff");
+
+    auto handle = [&](int pos, const QJsonObject& o) {
+        QString code;
+        if (o.contains("f12")) {
+            code = o.value("f12").toString();
+            if (code.size() != 6) return;
+            m_posCode.insert(pos, code);
+        } else {
+            code = m_posCode.value(pos);
+            if (code.isEmpty()) return;     // 还没见过全量帧
+        }
+
+        Spot& s = m_spots[code];
+        const double lastBefore = s.last;
+        const double peBefore = s.pe;
+        s.code = code;
+        if (o.contains("f14")) s.name = o.value("f14").toString();
+        if (o.contains("f100")) s.sector = o.value("f100").toString();
+        if (o.contains("f13")) s.market = o.value("f13").toInt();
+        double v = 0;
+        if (numberField(o, "f2", &v) && v > 0) s.last = v;
+        if (numberField(o, "f9", &v)) s.pe = v;
+
+        if (s.last > 0 && (s.last != lastBefore || s.pe != peBefore)) changed.push_back(s);
+    };
+
+    if (diffVal.isArray()) {
+        // 全量帧：数组下标即位置
+        const auto arr = diffVal.toArray();
+        m_posCode.clear();
+        for (int i = 0; i < arr.size(); ++i)
+            if (arr.at(i).isObject()) handle(i, arr.at(i).toObject());
+    } else if (diffVal.isObject()) {
+        const auto obj = diffVal.toObject();
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            bool ok = false;
+            const int pos = it.key().toInt(&ok);
+            if (ok && it.value().isObject()) handle(pos, it.value().toObject());
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Ma5Scanner.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+// 东财 clist 的 SSE 推送：一条长连接，首帧是全量列表，之后每帧只带变化的行和字段。
+// diff 以行位置为键，位置 -> 代码的对应取自带 f12 的帧；按代码排序订阅，位置才稳定。
+// 断线按退避自动重连，重连后的首帧全量会重新对齐位置
+class SpotStream : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SpotStream(QObject* parent = nullptr);
+
+    // .../api/qt/clist/get -> .../api/qt/clist/sse
+    static QString streamUrlFor(const QString& spotBaseUrl);
+
+    // 已在跑时换了源或地址会断开重连，否则只更新配置
+    void start(const ScanConfig& cfg);
+    void stop();
+    bool isRunning() const { return m_running; }
+
+    const QHash<QString, Spot>& spots() const { return m_spots; }
+
+    // 合并一帧 data 载荷，返回现价或市盈率有变化的行
+    QVector<Spot> applyMessage(const QByteArray& json);
+
+signals:
+    void spotsChanged(QVector<Spot> changed);
+    void connected();
+    void disconnected(const QString& reason);   // 随后自动重连
+
+private:
+    void connectStream();
+    void onReadyRead();
+    void onFinished();
+    void scheduleReconnect(const QString& reason);
+    void dispatchEvent();
+
+    QNetworkAccessManager* m_nam = nullptr;
+    QNetworkReply* m_reply = nullptr;
+    QTimer* m_reconnectTimer = nullptr;
+    QTimer* m_idleTimer = nullptr;      // 服务端会发心跳；长时间无字节视为断线
+
+    ScanConfig m_cfg;
+    bool m_running = false;
+    bool m_gotData = false;
+    int m_backoffMs = 0;
+    int m_serverRetryMs = 0;            // SSE retry: 字段
+
+    QByteArray m_buffer;                // 未成行的残余
+    QByteArray m_eventData;             // 当前事件已收到的 data 行
+
+    QHash<int, QString> m_posCode;
+    QHash<QString, Spot> m_spots;
+};
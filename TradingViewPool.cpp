@@ -0,0 +1,236 @@
+#include "TradingViewPool.h"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QtWebEngineWidgets/QWebEngineView>
+#include <QtWebEngineCore/QWebEnginePage>
+#include <QtWebEngineCore/QWebEngineProfile>
+#include <QtWebEngineCore/QWebEngineSettings>
+
+namespace {
+// 页面里只定义 pickwiseShow(symbol)，换股票时清空容器重建 widget；tv.js 只加载一次
+const char* kPageTemplate = R"(
+<!DOCTYPE html>
+<html>
+<head>
+  <meta charset="utf-8">
+  <style>
+    html, body, #tv_container { margin: 0; width: 100%; height: 100%; background: #101014; }
+  </style>
+</head>
+<body>
+  <div id="tv_container"></div>
+  <script src="%1"></script>
+  <script>
+    window.pickwiseShow = function(symbol) {
+      if (typeof TradingView === "undefined") return false;
+      document.getElementById("tv_container").innerHTML = "";
+      new TradingView.widget({
+        "autosize": true,
+        "symbol": symbol,
+        "interval": "D",
+        "timezone": "Asia/Shanghai",
+        "theme": "dark",
+        "style": "1",
+        "locale": "zh_CN",
+        "toolbar_bg": "#101014",
+        "enable_publishing": false,
+        "allow_symbol_change": true,
+        "studies": ["MASimple@tv-basicstudies", "MACD@tv-basicstudies", "RSI@tv-basicstudies"],
+        "container_id": "tv_container",
+        "withdateranges": true,
+        "hide_side_toolbar": false,
+        "details": true,
+        "show_popup_button": true,
+        "popup_width": "1200",
+        "popup_height": "720"
+      });
+      return true;
+    };
+  </script>
+</body>
+</html>
+)";
+
+const char* kFailureHtml = R"(
+<!DOCTYPE html>
+<html>
+<head><meta charset="utf-8"></head>
+<body style="margin:0;background:#101014;color:#c8c8d0;font-family:sans-serif;display:flex;align-items:center;justify-content:center;height:100vh;">
+  <div>TradingView 图表加载失败（网络不可用或 tv.js 拉取失败）。可切换到本地图表，或关闭窗口后重试。</div>
+</body>
+</html>
+)";
+}
+
+TradingViewPool& TradingViewPool::instance()
+{
+    static TradingViewPool* pool = new TradingViewPool(qApp);
+    return *pool;
+}
+
+TradingViewPool::TradingViewPool(QObject* parent)
+    : QObject(parent)
+{
+    // 命名 profile 才能落盘；tv.js 和 TradingView 的静态资源走磁盘缓存
+    m_profile = new QWebEngineProfile("Pickwise", this);
+    m_profile->setHttpCacheType(QWebEngineProfile::DiskHttpCache);
+    m_profile->setHttpCacheMaximumSize(64 * 1024 * 1024);
+
+    // 视图没有父对象时要在 QApplication 析构前删掉，且先于 profile
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &TradingViewPool::shutdown);
+}
+
+QString TradingViewPool::localScriptPath()
+{
+    // 本地副本：AppData/tv/tv.js 或程序目录下的 tv.js
+    const QStringList candidates = {
+        QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/tv/tv.js",
+        QCoreApplication::applicationDirPath() + "/tv.js",
+    };
+    for (const auto& path : candidates) {
+        if (QFileInfo::exists(path)) return path;
+    }
+    return QString();
+}
+
+void TradingViewPool::warmUp()
+{
+    if (!m_idle.isEmpty()) return;
+    m_idle.append(createView());
+}
+
+QWebEngineView* TradingViewPool::createView()
+{
+    auto* view = new QWebEngineView();
+    auto* page = new QWebEnginePage(m_profile, view);
+    page->settings()->setAttribute(QWebEngineSettings::JavascriptEnabled, true);
+    view->setPage(page);
+    m_states.insert(view, ViewState{});
+
+    connect(view, &QWebEngineView::loadFinished, this, [this, view](bool ok) {
+        auto it = m_states.find(view);
+        if (it == m_states.end() || it->failed) return;     // failed：这是提示页
+        it->loaded = ok;
+        if (!ok) {
+            // 离线打开等：与 applySymbol 一样整页重载一次，仍失败就提示
+            if (it->reloads >= 1) {
+                showFailure(view);
+                return;
+            }
+            ++it->reloads;
+            loadPage(view);
+            return;
+        }
+        if (!it->pendingSymbol.isEmpty()) {
+            const QString symbol = it->pendingSymbol;
+            it->pendingSymbol.clear();
+            applySymbol(view, symbol);
+        }
+    });
+    connect(view, &QObject::destroyed, this, [this, view]() {
+        m_states.remove(view);
+        m_idle.removeAll(view);
+    });
+
+    loadPage(view);
+    return view;
+}
+
+void TradingViewPool::loadPage(QWebEngineView* view)
+{
+    const QString local = localScriptPath();
+    const QString html = QString::fromUtf8(kPageTemplate)
+        .arg(local.isEmpty() ? QString("https://s3.tradingview.com/tv.js")
+                             : QUrl::fromLocalFile(local).toString());
+    if (local.isEmpty()) {
+        view->setHtml(html, QUrl("https://s3.tradingview.com/"));
+    } else {
+        // file:// 页面要访问 tradingview.com 的 iframe
+        view->page()->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessRemoteUrls, true);
+        view->setHtml(html, QUrl::fromLocalFile(QFileInfo(local).absolutePath() + "/"));
+    }
+}
+
+QWebEngineView* TradingViewPool::acquire(QWidget* parent)
+{
+    QWebEngineView* view = m_idle.isEmpty() ? createView() : m_idle.takeFirst();
+    view->setParent(parent);
+    return view;
+}
+
+void TradingViewPool::release(QWebEngineView* view)
+{
+    if (!view || !m_states.contains(view)) return;
+    view->hide();
+    view->setParent(nullptr);
+    if (m_idle.size() >= maxIdle) {
+        view->deleteLater();
+        return;
+    }
+    m_idle.append(view);
+}
+
+void TradingViewPool::showSymbol(QWebEngineView* view, const QString& symbol)
+{
+    auto it = m_states.find(view);
+    if (it == m_states.end()) return;
+    if (it->failed) {
+        // 上次失败留下的提示页：重新加载页面再切
+        it->failed = false;
+        it->reloads = 0;
+        it->pendingSymbol = symbol;
+        loadPage(view);
+        return;
+    }
+    if (!it->loaded) {
+        it->pendingSymbol = symbol;     // 页面还在加载，加载完再切
+        return;
+    }
+    applySymbol(view, symbol);
+}
+
+void TradingViewPool::applySymbol(QWebEngineView* view, const QString& symbol)
+{
+    const QString js = QString("window.pickwiseShow && window.pickwiseShow(\"%1\");")
+                           .arg(QString(symbol).remove('"').remove('\\'));
+    view->page()->runJavaScript(js, [this, view, symbol](const QVariant& result) {
+        // tv.js 没加载成功（比如刚恢复联网）就整页重载一次，仍失败就提示
+        auto it = m_states.find(view);
+        if (it == m_states.end()) return;
+        if (result.toBool()) {
+            it->reloads = 0;
+            return;
+        }
+        if (it->reloads >= 1) {
+            showFailure(view);
+            return;
+        }
+        ++it->reloads;
+        it->loaded = false;
+        it->pendingSymbol = symbol;
+        loadPage(view);
+    });
+}
+
+void TradingViewPool::showFailure(QWebEngineView* view)
+{
+    auto it = m_states.find(view);
+    if (it == m_states.end()) return;
+    it->failed = true;
+    it->loaded = false;
+    it->pendingSymbol.clear();
+    view->setHtml(QString::fromUtf8(kFailureHtml));
+}
+
+void TradingViewPool::shutdown()
+{
+    const QList<QWebEngineView*> views = m_states.keys();
+    m_idle.clear();
+    m_states.clear();
+    for (auto* view : views) {
+        if (!view->parent()) delete view;
+    }
+}
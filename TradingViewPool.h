@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+class QWebEngineProfile;
+class QWebEngineView;
+class QWidget;
+
+// 共享的 TradingView 视图池：页面只加载一次（tv.js 优先用本地副本，否则走磁盘 HTTP 缓存），
+// 换股票时在已有页面里用 JS 重建 widget，不再重建整套浏览器
+class TradingViewPool : public QObject
+{
+    Q_OBJECT
+public:
+    static TradingViewPool& instance();
+
+    // 启动后空闲时预热一个视图
+    void warmUp();
+
+    // 取一个视图挂到 parent 下；用完 release 归还（不要 delete）
+    QWebEngineView* acquire(QWidget* parent);
+    void release(QWebEngineView* view);
+    void showSymbol(QWebEngineView* view, const QString& symbol);
+
+    int maxIdle = 2;
+
+private:
+    explicit TradingViewPool(QObject* parent = nullptr);
+
+    QWebEngineView* createView();
+    void loadPage(QWebEngineView* view);
+    void applySymbol(QWebEngineView* view, const QString& symbol);
+    void showFailure(QWebEngineView* view);
+    void shutdown();
+    static QString localScriptPath();
+
+    struct ViewState {
+        bool loaded = false;
+        QString pendingSymbol;
+        int reloads = 0;
+        bool failed = false;    // 重载后仍失败，正显示提示页；下次 showSymbol 再重新加载
+    };
+
+    QWebEngineProfile* m_profile = nullptr;
+    QList<QWebEngineView*> m_idle;
+    QHash<QWebEngineView*, ViewState> m_states;
+};
@@ -0,0 +1,20 @@
+# 核心基准测试：合成 / 录制的响应、合成缓存；结果输出 JSON 或 CSV，便于跨版本比对
+QT       = core network concurrent
+
+CONFIG += c++17 console alloc_count
+CONFIG -= app_bundle
+
+TARGET = pickwise-bench
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core/core.pri)
+
+SOURCES += \
+    main.cpp
+
+msvc
+{
+    QMAKE_CFLAGS += /utf-8
+    QMAKE_CXXFLAGS += /utf-8
+}
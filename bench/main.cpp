@@ -0,0 +1,338 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include "Ma5Scanner.h"
+#include "BacktestEngine.h"
+#include "ChartLod.h"
+#include "MemoryUsage.h"
+
+// Ma5Scanner 的友元：解析 / 统计 / 缓存读写是私有的
+class ScannerBench
+{
+public:
+    static bool parseKline(const QByteArray& body, QVector<QString>& dates, QVector<double>& closes)
+    {
+        return Ma5Scanner::parseKlineBarsEastmoney(body, dates, closes);
+    }
+    static bool parseSpot(const QByteArray& body, QVector<Spot>& out)
+    {
+        return Ma5Scanner::parseSpotPageEastmoney(body, out, nullptr);
+    }
+    static bool stats(const QVector<QString>& dates, const QVector<double>& closes, KlineStats& out)
+    {
+        return Ma5Scanner::computeStatsFromBars(dates, closes, 3, 5, out);
+    }
+    static void fillCache(Ma5Scanner& s, const QVector<QString>& dates, const QVector<double>& closes, int symbols)
+    {
+        for (int i = 0; i < symbols; ++i) {
+            s.cachePut(QString("%1.%2").arg(i % 3).arg(600000 + i, 6, 10, QChar('0')), dates, closes);
+        }
+    }
+    static void saveCache(Ma5Scanner& s) { s.saveCache(); }
+    static void loadCache(Ma5Scanner& s) { s.loadCache(); }
+    static QString cachePath(const Ma5Scanner& s) { return s.cachePath(); }
+};
+
+namespace {
+struct BenchResult {
+    QString name;
+    qint64 iterations = 0;
+    double nsPerOp = 0;
+    double itemsPerOp = 0;      // 每次调用处理的条数（K线根数 / 行数）
+    QString itemUnit;
+    double nsPerItem = 0;
+    double mbPerSec = 0;        // 输入字节吞吐，无字节概念时为 0
+    double allocsPerOp = 0;
+};
+
+struct BenchOptions {
+    qint64 minTimeMs = 300;
+    qint64 maxIterations = 1000000;
+};
+
+// 先热身一次，再跑到累计 minTimeMs
+BenchResult measure(const QString& name, double items, const QString& unit, qint64 bytes,
+                    const BenchOptions& opt, const std::function<void()>& fn)
+{
+    fn();
+
+    BenchResult r;
+    r.name = name;
+    r.itemsPerOp = items;
+    r.itemUnit = unit;
+
+    const qint64 allocsBefore = MemoryUsage::allocationCount();
+    QElapsedTimer t;
+    t.start();
+    qint64 iters = 0;
+    while (iters < opt.maxIterations) {
+        fn();
+        ++iters;
+        if (t.elapsed() >= opt.minTimeMs) break;
+    }
+    const qint64 ns = t.nsecsElapsed();
+    const qint64 allocs = MemoryUsage::allocationCount() - allocsBefore;
+
+    r.iterations = iters;
+    r.nsPerOp = double(ns) / iters;
+    r.nsPerItem = items > 0 ? r.nsPerOp / items : 0;
+    r.mbPerSec = (bytes > 0 && ns > 0) ? (double(bytes) * iters / (1024.0 * 1024.0)) / (ns / 1e9) : 0;
+    r.allocsPerOp = double(allocs) / iters;
+    return r;
+}
+
+// 合成数据：随机游走收盘价，日期按工作日递增，与东财 fields2=f51,f52,f53 一致
+void syntheticBars(int n, quint32 seed, QVector<QString>* dates, QVector<double>* opens, QVector<double>* closes)
+{
+    QRandomGenerator rng(seed);
+    QDate d(2015, 1, 5);
+    double px = 10.0;
+    for (int i = 0; i < n; ++i) {
+        while (d.dayOfWeek() > 5) d = d.addDays(1);
+        const double open = px * (1.0 + (rng.generateDouble() - 0.5) * 0.02);
+        px = std::max(1.0, px * (1.0 + (rng.generateDouble() - 0.5) * 0.06));
+        dates->push_back(d.toString("yyyy-MM-dd"));
+        if (opens) opens->push_back(open);
+        closes->push_back(px);
+        d = d.addDays(1);
+    }
+}
+
+QByteArray klinePayload(int n, quint32 seed)
+{
+    QVector<QString> dates;
+    QVector<double> opens, closes;
+    syntheticBars(n, seed, &dates, &opens, &closes);
+    QJsonArray klines;
+    for (int i = 0; i < n; ++i) {
+        klines.append(QString("%1,%2,%3").arg(dates[i])
+                          .arg(opens[i], 0, 'f', 2).arg(closes[i], 0, 'f', 2));
+    }
+    QJsonObject data;
+    data.insert("code", "600000");
+    data.insert("market", 1);
+    data.insert("klines", klines);
+    QJsonObject root;
+    root.insert("rc", 0);
+    root.insert("data", data);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+QByteArray spotPayload(int rows, quint32 seed)
+{
+    static const char* kSectors[] = {"银行", "半导体", "医药商业", "光伏设备", "白酒", "软件开发"};
+    QRandomGenerator rng(seed);
+    QJsonArray diff;
+    for (int i = 0; i < rows; ++i) {
+        QJsonObject o;
+        o.insert("f2", 2.0 + rng.generateDouble() * 80.0);
+        o.insert("f9", rng.generateDouble() * 60.0);
+        o.insert("f12", QString("%1").arg(600000 + i, 6, 10, QChar('0')));
+        o.insert("f13", 1);
+        o.insert("f14", QString("样本股票%1").arg(i));
+        o.insert("f100", QString::fromUtf8(kSectors[i % 6]));
+        diff.append(o);
+    }
+    QJsonObject data;
+    data.insert("total", 5300);
+    data.insert("diff", diff);
+    QJsonObject root;
+    root.insert("rc", 0);
+    root.insert("data", data);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+QJsonObject toJson(const BenchResult& r)
+{
+    QJsonObject o;
+    o.insert("name", r.name);
+    o.insert("iterations", double(r.iterations));
+    o.insert("ns_per_op", r.nsPerOp);
+    o.insert("items_per_op", r.itemsPerOp);
+    o.insert("item_unit", r.itemUnit);
+    o.insert("ns_per_item", r.nsPerItem);
+    o.insert("mb_per_s", r.mbPerSec);
+    o.insert("allocs_per_op", r.allocsPerOp);
+    return o;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("pickwise-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pickwise 核心基准测试");
+    parser.addHelpOption();
+    const QCommandLineOption payloadOpt("payloads", "录制的响应目录：kline*.json / spot*.json。", "dir");
+    const QCommandLineOption filterOpt("filter", "只跑名称包含该子串的用例。", "text");
+    const QCommandLineOption minTimeOpt("min-time", "每个用例最少运行毫秒数。", "ms", "300");
+    const QCommandLineOption formatOpt("format", "json（默认）或 csv。", "fmt", "json");
+    const QCommandLineOption outputOpt({"o", "output"}, "输出文件，缺省为标准输出。", "file");
+    parser.addOptions({payloadOpt, filterOpt, minTimeOpt, formatOpt, outputOpt});
+    parser.process(app);
+
+    // 缓存读写落到测试目录，不碰真实数据
+    QStandardPaths::setTestModeEnabled(true);
+
+    BenchOptions opt;
+    opt.minTimeMs = std::max<qint64>(1, parser.value(minTimeOpt).toLongLong());
+    const QString filter = parser.value(filterOpt);
+    QVector<BenchResult> results;
+    auto run = [&](const QString& name, double items, const QString& unit, qint64 bytes,
+                   const std::function<void()>& fn) {
+        if (!filter.isEmpty() && !name.contains(filter)) return;
+        results.push_back(measure(name, items, unit, bytes, opt, fn));
+        std::fprintf(stderr, "%-40s %12.0f ns/op\n", qPrintable(name), results.back().nsPerOp);
+    };
+
+    // 解析：合成响应 + 可选的录制响应
+    QVector<QPair<QString, QByteArray>> klineBodies = {
+        {"synthetic_120", klinePayload(120, 1)},
+        {"synthetic_500", klinePayload(500, 2)},
+    };
+    QVector<QPair<QString, QByteArray>> spotBodies = {
+        {"synthetic_200", spotPayload(200, 3)},
+    };
+    if (parser.isSet(payloadOpt)) {
+        const QDir dir(parser.value(payloadOpt));
+        for (const auto& fi : dir.entryInfoList({"*.json"}, QDir::Files, QDir::Name)) {
+            QFile f(fi.absoluteFilePath());
+            if (!f.open(QIODevice::ReadOnly)) continue;
+            const QByteArray body = f.readAll();
+            if (fi.fileName().startsWith("kline")) klineBodies.push_back({fi.completeBaseName(), body});
+            else if (fi.fileName().startsWith("spot")) spotBodies.push_back({fi.completeBaseName(), body});
+        }
+    }
+
+    for (const auto& kb : klineBodies) {
+        QVector<QString> dates;
+        QVector<double> closes;
+        if (!ScannerBench::parseKline(kb.second, dates, closes)) continue;
+        const QByteArray body = kb.second;
+        run("parseKlineBarsEastmoney/" + kb.first, closes.size(), "bar", body.size(), [&]() {
+            QVector<QString> d;
+            QVector<double> c;
+            ScannerBench::parseKline(body, d, c);
+        });
+        run("computeStatsFromBars/" + kb.first, closes.size(), "bar", 0, [&]() {
+            KlineStats st;
+            ScannerBench::stats(dates, closes, st);
+        });
+    }
+    for (const auto& sb : spotBodies) {
+        QVector<Spot> rows;
+        if (!ScannerBench::parseSpot(sb.second, rows)) continue;
+        const QByteArray body = sb.second;
+        run("parseSpotPageEastmoney/" + sb.first, rows.size(), "row", body.size(), [&]() {
+            QVector<Spot> out;
+            ScannerBench::parseSpot(body, out);
+        });
+    }
+
+    // 指标
+    {
+        QVector<QString> dates;
+        QVector<double> opens, closes;
+        syntheticBars(2500, 4, &dates, &opens, &closes);
+        run("movingAverage/2500", closes.size(), "bar", 0, [&]() {
+            BacktestEngine::movingAverage(closes, 5);
+        });
+
+        DailyBars bars;
+        for (int i = 0; i < closes.size(); ++i) {
+            bars.dates.push_back(QDate::fromString(dates[i], "yyyy-MM-dd"));
+            bars.opens.push_back(opens[i]);
+            bars.closes.push_back(closes[i]);
+            bars.highs.push_back(std::max(opens[i], closes[i]) * 1.01);
+            bars.lows.push_back(std::min(opens[i], closes[i]) * 0.99);
+        }
+        const QDate from = bars.dates.first();
+        const QDate to = bars.dates.last();
+        run("backtest.prepare/2500", bars.size(), "bar", 0, [&]() {
+            PreparedSeries s;
+            BacktestEngine::prepare("600000", bars, from, to, &s, nullptr);
+        });
+        PreparedSeries series;
+        BacktestEngine::prepare("600000", bars, from, to, &series, nullptr);
+        run("backtest.simulate/2500", bars.size(), "bar", 0, [&]() {
+            SymbolBacktest res;
+            BacktestEngine::simulate(series, BacktestParams{}, res, false);
+        });
+
+        QVector<QPointF> pts;
+        for (int i = 0; i < closes.size(); ++i) pts.push_back(QPointF(i, closes[i]));
+        run("lttb/2500->500", pts.size(), "point", 0, [&]() {
+            ChartLod::lttb(pts, 500);
+        });
+    }
+
+    // 文件缓存：全市场规模的合成缓存
+    {
+        Ma5Scanner scanner;
+        QVector<QString> dates;
+        QVector<double> closes;
+        syntheticBars(60, 5, &dates, nullptr, &closes);
+        const int symbols = 5000;
+        ScannerBench::fillCache(scanner, dates, closes, symbols);
+        ScannerBench::saveCache(scanner);
+        const QString path = ScannerBench::cachePath(scanner);
+        const qint64 bytes = QFileInfo(path).size();
+        const double bars = double(symbols) * closes.size();
+
+        run("saveCache/5000x60", bars, "bar", bytes, [&]() { ScannerBench::saveCache(scanner); });
+        run("loadCache/5000x60", bars, "bar", bytes, [&]() { ScannerBench::loadCache(scanner); });
+        QFile::remove(path);
+    }
+
+    // 输出
+    QByteArray out;
+    const QString format = parser.value(formatOpt).toLower();
+    if (format == "csv") {
+        out = "name,iterations,ns_per_op,items_per_op,item_unit,ns_per_item,mb_per_s,allocs_per_op\n";
+        for (const auto& r : results) {
+            out += QString("%1,%2,%3,%4,%5,%6,%7,%8\n")
+                       .arg(r.name).arg(r.iterations)
+                       .arg(r.nsPerOp, 0, 'f', 1).arg(r.itemsPerOp, 0, 'f', 0).arg(r.itemUnit)
+                       .arg(r.nsPerItem, 0, 'f', 2).arg(r.mbPerSec, 0, 'f', 2)
+                       .arg(r.allocsPerOp, 0, 'f', 1).toUtf8();
+        }
+    } else {
+        QJsonArray arr;
+        for (const auto& r : results) arr.append(toJson(r));
+        QJsonObject root;
+        root.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+        root.insert("qt", QString::fromLatin1(qVersion()));
+        root.insert("cpu", QSysInfo::currentCpuArchitecture());
+        root.insert("os", QSysInfo::prettyProductName());
+        root.insert("results", arr);
+        out = QJsonDocument(root).toJson(QJsonDocument::Indented);
+    }
+
+    const QString outputPath = parser.value(outputOpt);
+    if (outputPath.isEmpty()) {
+        std::fwrite(out.constData(), 1, size_t(out.size()), stdout);
+        std::fflush(stdout);
+        return 0;
+    }
+    QSaveFile f(outputPath);
+    if (!f.open(QIODevice::WriteOnly)) return 1;
+    f.write(out);
+    return f.commit() ? 0 : 1;
+}
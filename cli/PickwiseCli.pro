@@ -0,0 +1,26 @@
+# 无界面扫描器：只依赖 QtCore / QtNetwork，供 cron / supervisor 在服务器上跑
+QT       = core network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = pickwise-cli
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core/core.pri)
+# 只用到扫描器，不需要 concurrent
+QT -= concurrent
+
+SOURCES += \
+    main.cpp
+
+msvc
+{
+    QMAKE_CFLAGS += /utf-8
+    QMAKE_CXXFLAGS += /utf-8
+}
+
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,290 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <cstdio>
+#include "Ma5Scanner.h"
+#include "ScanJson.h"
+
+#ifdef Q_OS_UNIX
+#include <QSocketNotifier>
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// 退出码：供 cron / supervisor 判断
+enum ExitCode {
+    ExitOk = 0,
+    ExitScanFailed = 1,
+    ExitUsage = 2,
+    ExitOutputFailed = 3,
+    ExitTimeout = 4,
+    ExitInterrupted = 130,
+    ExitTerminated = 143
+};
+
+namespace {
+QTextStream& err()
+{
+    static QTextStream ts(stderr);
+    return ts;
+}
+
+#ifdef Q_OS_UNIX
+// 自管道：信号处理函数里只写一个字节，真正的收尾放回事件循环
+int g_signalFd[2] = {-1, -1};
+
+void onSignal(int sig)
+{
+    const char c = char(sig);
+    ssize_t n = ::write(g_signalFd[0], &c, 1);
+    (void)n;
+}
+
+bool installSignalHandlers()
+{
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, g_signalFd) != 0) return false;
+    struct sigaction sa = {};
+    sa.sa_handler = onSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    return ::sigaction(SIGTERM, &sa, nullptr) == 0 && ::sigaction(SIGINT, &sa, nullptr) == 0;
+}
+#endif
+
+// 配置文件与命令行用同一套键名；文件先生效，命令行覆盖
+bool applyConfigFile(const QString& path, ScanConfig& cfg, QString* error)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        *error = QString("无法读取配置文件：%1").arg(path);
+        return false;
+    }
+    QJsonParseError pe;
+    const auto doc = QJsonDocument::fromJson(f.readAll(), &pe);
+    if (!doc.isObject()) {
+        *error = QString("配置文件不是 JSON 对象：%1").arg(pe.errorString());
+        return false;
+    }
+    return ScanJson::applyConfig(doc.object(), cfg, error);
+}
+
+QByteArray toCsv(const QVector<PickRow>& rows)
+{
+    auto quote = [](const QString& s) {
+        if (!s.contains(',') && !s.contains('"') && !s.contains('\n')) return s;
+        QString q = s;
+        q.replace("\"", "\"\"");
+        return "\"" + q + "\"";
+    };
+    QByteArray out = "code,name,sector,pe,last,ma5,biasPct,days\n";
+    for (const auto& r : rows) {
+        out += QStringList{
+            quote(r.code), quote(r.name), quote(r.sector),
+            QString::number(r.pe, 'f', 2),
+            QString::number(r.last, 'f', 2),
+            QString::number(r.ma5, 'f', 3),
+            QString::number(r.biasPct, 'f', 2),
+            QString::number(r.belowDays),
+        }.join(',').toUtf8();
+        out += '\n';
+    }
+    return out;
+}
+
+QByteArray toJson(const QVector<PickRow>& rows)
+{
+    return QJsonDocument(ScanJson::rows(rows)).toJson(QJsonDocument::Indented);
+}
+
+// 输出文件用 QSaveFile 原子替换，被中途杀掉也不会留下半个文件
+bool writeOutput(const QString& path, const QByteArray& data)
+{
+    if (path.isEmpty() || path == "-") {
+        return std::fwrite(data.constData(), 1, size_t(data.size()), stdout) == size_t(data.size())
+            && std::fflush(stdout) == 0;
+    }
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    f.write(data);
+    return f.commit();
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QLoggingCategory::setFilterRules(
+        QStringLiteral("qt.network.monitor.warning=false\n"
+                       "qt.network.monitor.info=false\n"
+                       "qt.network.monitor.debug=false\n")
+    );
+
+    QCoreApplication app(argc, argv);
+    // 与 GUI 共用 AppData 下的 K 线缓存
+    QCoreApplication::setApplicationName("Pickwise");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pickwise MA5 扫描（无界面）");
+    parser.addHelpOption();
+    const QCommandLineOption configOpt("config", "JSON 配置文件，键名同 ScanConfig 字段。", "file");
+    const QCommandLineOption modeOpt("mode", "break（站上MA5）或 pullback（回踩MA5）。", "mode");
+    const QCommandLineOption daysOpt("days", "break：前 N 日收盘 < MA5。", "n");
+    const QCommandLineOption aboveDaysOpt("above-days", "pullback：前 N 日收盘 > MA5。", "n");
+    const QCommandLineOption toleranceOpt("tolerance", "pullback：距 MA5 容差 %。", "pct");
+    const QCommandLineOption slopeOpt("slope-up", "要求 MA5 上行。");
+    const QCommandLineOption noBjOpt("no-bj", "排除北交所。");
+    const QCommandLineOption topKOpt("top-k", "只保留排序最靠前的 K 只，0 为不限。", "k");
+    const QCommandLineOption providerOpt("provider", "eastmoney 或 sina。", "name");
+    const QCommandLineOption inFlightOpt("max-in-flight", "并发请求数。", "n");
+    const QCommandLineOption formatOpt("format", "csv 或 json；缺省按输出文件扩展名，否则 csv。", "fmt");
+    const QCommandLineOption outputOpt({"o", "output"}, "输出文件，缺省或 - 为标准输出。", "file");
+    const QCommandLineOption deadlineOpt("deadline", "整体超时秒数，0 为不限。", "sec", "0");
+    const QCommandLineOption quietOpt({"q", "quiet"}, "不在标准错误输出进度。");
+    const QCommandLineOption reportOpt("report", "另存本次扫描的性能汇总（JSON：延迟直方图、计数器）。", "file");
+    const QCommandLineOption traceOpt("trace", "另存本次扫描的时间线（Chrome trace-event JSON）。", "file");
+    const QCommandLineOption resumeOpt("resume", "有当天同源的断点（上次超时 / 中断留下）时只扫剩下的股票。");
+    parser.addOptions({configOpt, modeOpt, daysOpt, aboveDaysOpt, toleranceOpt, slopeOpt, noBjOpt,
+                       topKOpt, providerOpt, inFlightOpt, formatOpt, outputOpt, deadlineOpt, quietOpt,
+                       reportOpt, traceOpt, resumeOpt});
+
+    ScanConfig cfg;
+    QString error;
+    auto usage = [&](const QString& msg) {
+        err() << msg << "\n";
+        err().flush();
+        return int(ExitUsage);
+    };
+    // 不用 process()：它在参数错误时以 1 退出，和“扫描失败”撞码
+    if (!parser.parse(app.arguments())) return usage(parser.errorText());
+    if (parser.isSet("help")) parser.showHelp(ExitOk);
+    auto intArg = [&](const QCommandLineOption& opt, int* out) {
+        if (!parser.isSet(opt)) return true;
+        bool ok = false;
+        const int v = parser.value(opt).toInt(&ok);
+        if (ok && v >= 0) *out = v;
+        return ok && v >= 0;
+    };
+
+    if (parser.isSet(configOpt) && !applyConfigFile(parser.value(configOpt), cfg, &error)) return usage(error);
+    if (parser.isSet(modeOpt) && !ScanJson::parseMode(parser.value(modeOpt), &cfg.mode)) return usage("--mode 只能是 break 或 pullback");
+    if (parser.isSet(providerOpt) && !ScanJson::parseProvider(parser.value(providerOpt), &cfg.provider)) return usage("--provider 只能是 eastmoney 或 sina");
+    if (!intArg(daysOpt, &cfg.belowDays) || !intArg(aboveDaysOpt, &cfg.pullbackAboveDays)
+        || !intArg(topKOpt, &cfg.topK) || !intArg(inFlightOpt, &cfg.maxInFlight)) {
+        return usage("整数参数无效");
+    }
+    if (parser.isSet(toleranceOpt)) {
+        bool ok = false;
+        cfg.pullbackTolerancePct = parser.value(toleranceOpt).toDouble(&ok);
+        if (!ok) return usage("--tolerance 无效");
+    }
+    if (parser.isSet(slopeOpt)) cfg.requireMa5SlopeUp = true;
+    if (parser.isSet(noBjOpt)) cfg.includeBJ = false;
+    if (cfg.maxInFlight <= 0) return usage("--max-in-flight 必须大于 0");
+
+    const QString outputPath = parser.value(outputOpt);
+    QString format = parser.value(formatOpt).toLower();
+    if (format.isEmpty()) format = QFileInfo(outputPath).suffix().toLower() == "json" ? "json" : "csv";
+    if (format != "csv" && format != "json") return usage("--format 只能是 csv 或 json");
+
+    bool deadlineOk = false;
+    const int deadlineSec = parser.value(deadlineOpt).toInt(&deadlineOk);
+    if (!deadlineOk || deadlineSec < 0) return usage("--deadline 无效");
+    const bool quiet = parser.isSet(quietOpt);
+    const QString reportPath = parser.value(reportOpt);
+    const QString tracePath = parser.value(traceOpt);
+
+    Ma5Scanner scanner;
+
+#ifdef Q_OS_UNIX
+    if (installSignalHandlers()) {
+        auto* notifier = new QSocketNotifier(g_signalFd[1], QSocketNotifier::Read, &app);
+        QObject::connect(notifier, &QSocketNotifier::activated, &app, [&]() {
+            char sig = 0;
+            if (::read(g_signalFd[1], &sig, 1) != 1) return;
+            err() << "收到信号 " << int(sig) << "，取消扫描\n";
+            err().flush();
+            scanner.cancel();
+            QCoreApplication::exit(sig == SIGINT ? ExitInterrupted : ExitTerminated);
+        });
+    }
+#endif
+
+    QElapsedTimer clock;
+    clock.start();
+    if (deadlineSec > 0) {
+        QTimer::singleShot(deadlineSec * 1000, &app, [&]() {
+            err() << "超过 " << deadlineSec << " 秒仍未完成，放弃\n";
+            err().flush();
+            scanner.cancel();
+            QCoreApplication::exit(ExitTimeout);
+        });
+    }
+
+    // 进度只在百分比变化时打印，避免把 supervisor 的日志刷满
+    int lastPct = -1;
+    if (!quiet) {
+        QObject::connect(&scanner, &Ma5Scanner::stageChanged, &app, [](const QString& text) {
+            err() << text << "\n";
+            err().flush();
+        });
+        QObject::connect(&scanner, &Ma5Scanner::progress, &app, [&lastPct](int done, int total) {
+            if (total <= 0) return;
+            const int pct = int(100LL * done / total);
+            if (pct == lastPct) return;
+            lastPct = pct;
+            err() << "进度 " << done << "/" << total << " (" << pct << "%)\n";
+            err().flush();
+        });
+    }
+    // 先于 finished / failed 发出；写不出来只告警，不影响结果输出和退出码
+    QObject::connect(&scanner, &Ma5Scanner::metricsReady, &app, [&](const QJsonObject& summary) {
+        if (!quiet) {
+            err() << ScanMetrics::describe(summary) << "\n";
+            err().flush();
+        }
+        if (!reportPath.isEmpty() && !writeOutput(reportPath, QJsonDocument(summary).toJson(QJsonDocument::Indented))) {
+            err() << "写出性能汇总失败：" << reportPath << "\n";
+            err().flush();
+        }
+        if (!tracePath.isEmpty() && !writeOutput(tracePath, scanner.metrics().chromeTrace())) {
+            err() << "写出时间线失败：" << tracePath << "\n";
+            err().flush();
+        }
+    });
+    QObject::connect(&scanner, &Ma5Scanner::failed, &app, [](const QString& reason) {
+        err() << reason << "\n";
+        err().flush();
+        QCoreApplication::exit(ExitScanFailed);
+    });
+    QObject::connect(&scanner, &Ma5Scanner::finished, &app, [&](const QVector<PickRow>& rows) {
+        const QByteArray data = (format == "json") ? toJson(rows) : toCsv(rows);
+        if (!writeOutput(outputPath, data)) {
+            err() << "写出结果失败：" << (outputPath.isEmpty() ? QString("stdout") : outputPath) << "\n";
+            err().flush();
+            QCoreApplication::exit(ExitOutputFailed);
+            return;
+        }
+        if (!quiet) {
+            err() << rows.size() << " 只满足条件，用时 " << clock.elapsed() << " ms\n";
+            err().flush();
+        }
+        QCoreApplication::exit(ExitOk);
+    });
+
+    if (parser.isSet(resumeOpt) && scanner.resume(cfg)) {
+        if (!quiet) {
+            err() << "从断点续扫\n";
+            err().flush();
+        }
+    } else {
+        scanner.runOnce(cfg);
+    }
+    return app.exec();
+}
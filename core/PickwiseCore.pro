@@ -0,0 +1,46 @@
+# 扫描 / K线仓库 / 推演核心：只依赖 QtCore、QtNetwork、QtConcurrent，供 GUI、CLI 和基准测试共用
+TEMPLATE = lib
+CONFIG += staticlib c++17
+
+QT       = core network concurrent
+
+TARGET = PickwiseCore
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    ../BacktestCache.cpp \
+    ../BacktestEngine.cpp \
+    ../BacktestSweep.cpp \
+    ../BarFetcher.cpp \
+    ../BarStore.cpp \
+    ../ChartLod.cpp \
+    ../KlineHub.cpp \
+    ../Ma5Scanner.cpp \
+    ../MemoryUsage.cpp \
+    ../PriceBandIndex.cpp \
+    ../ScanMetrics.cpp \
+    ../ScanJson.cpp \
+    ../SpotStream.cpp
+
+HEADERS += \
+    ../BacktestCache.h \
+    ../BacktestEngine.h \
+    ../BacktestSweep.h \
+    ../BarFetcher.h \
+    ../BarStore.h \
+    ../ChartLod.h \
+    ../KlineHub.h \
+    ../Ma5Scanner.h \
+    ../MemoryUsage.h \
+    ../PickRow.h \
+    ../PriceBandIndex.h \
+    ../ScanMetrics.h \
+    ../ScanJson.h \
+    ../SpotStream.h
+
+msvc
+{
+    QMAKE_CFLAGS += /utf-8
+    QMAKE_CXXFLAGS += /utf-8
+}
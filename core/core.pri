@@ -0,0 +1,17 @@
+# 链接 PickwiseCore 静态库；使用方都在源码根目录下一层（app / cli / bench）
+INCLUDEPATH += $$PWD/..
+DEPENDPATH += $$PWD/..
+
+QT += network concurrent
+
+CORE_OUT = $$OUT_PWD/../core
+win32:CONFIG(release, debug|release): CORE_OUT = $$CORE_OUT/release
+else:win32:CONFIG(debug, debug|release): CORE_OUT = $$CORE_OUT/debug
+
+LIBS += -L$$CORE_OUT -lPickwiseCore
+
+win32-g++|!win32: PRE_TARGETDEPS += $$CORE_OUT/libPickwiseCore.a
+else: PRE_TARGETDEPS += $$CORE_OUT/PickwiseCore.lib
+
+# 分配计数接管 malloc，必须编进可执行文件本身；只给基准测试用，CONFIG += alloc_count 打开
+alloc_count: SOURCES += $$PWD/../AllocCounter.cpp
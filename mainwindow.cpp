@@ -3,6 +3,8 @@
 #include "BacktestWidget.h"
 #include "KlineDialog.h"
 #include "KlineButtonDelegate.h"
+#include "MemoryUsage.h"
+#include "TradingViewPool.h"
 
 #include <QMessageBox>
 #include <QFileDialog>
@@ -10,6 +12,12 @@
 #include <QTextStream>
 #include <QVBoxLayout>
 #include <QVariant>
+#include <QSignalBlocker>
+#include <QTimer>
+#include <QTime>
+#include <QApplication>
+#include <QStatusBar>
+#include <QSystemTrayIcon>
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -30,7 +38,7 @@ MainWindow::MainWindow(QWidget *parent)
         QString spotUrl;
         QString klineUrl;
     };
-    const QVector<ApiProvider> providers = {
+    QVector<ApiProvider> providers = {
         {"东财主站(82)", ScanConfig::Provider::Eastmoney, "https://82.push2.eastmoney.com/api/qt/clist/get", "https://push2his.eastmoney.com/api/qt/stock/kline/get"},
         {"东财镜像(83)", ScanConfig::Provider::Eastmoney, "https://83.push2.eastmoney.com/api/qt/clist/get", "https://push2his.eastmoney.com/api/qt/stock/kline/get"},
         {"东财镜像(84)", ScanConfig::Provider::Eastmoney, "https://84.push2.eastmoney.com/api/qt/clist/get", "https://push2his.eastmoney.com/api/qt/stock/kline/get"},
@@ -40,6 +48,12 @@ MainWindow::MainWindow(QWidget *parent)
         {"新浪财经(HTTPS+移动K线)", ScanConfig::Provider::Sina, "https://money.finance.sina.com.cn/quotes_service/api/jsonp_v2.php/IO.XSRV2.CallbackList/Market_Center.getHQNodeData", "https://quotes.sina.cn/cn/api/json_v2.php/CN_MarketData.getKLineData"},
         {"新浪财经(HTTP+移动K线)", ScanConfig::Provider::Sina, "http://money.finance.sina.com.cn/quotes_service/api/jsonp_v2.php/IO.XSRV2.CallbackList/Market_Center.getHQNodeData", "http://quotes.sina.cn/cn/api/json_v2.php/CN_MarketData.getKLineData"}
     };
+    // 本地行情替身（quotefeed/），离线调试扫描和盯盘用
+    const QString feed = qEnvironmentVariable("PICKWISE_QUOTEFEED");
+    if (!feed.isEmpty()) {
+        providers.push_back({"本地替身(" + feed + ")", ScanConfig::Provider::Eastmoney,
+                             feed + "/api/qt/clist/get", feed + "/api/qt/stock/kline/get"});
+    }
     for (const auto& p : providers) {
         QVariantMap payload;
         payload.insert("provider", static_cast<int>(p.provider));
@@ -77,48 +91,30 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(klineDelegate, &KlineButtonDelegate::klineClicked, this, [this](const QModelIndex& index) {
         if (!index.isValid()) return;
-        const auto& rows = m_model->rows();
-        if (index.row() < 0 || index.row() >= rows.size()) return;
-        const auto& row = rows[index.row()];
+        if (index.row() < 0 || index.row() >= m_model->rowCount()) return;
+        const auto& row = m_model->rowAt(index.row());
         auto* dialog = new KlineDialog(row.code, row.market, row.name, this);
         dialog->setAttribute(Qt::WA_DeleteOnClose, true);
         dialog->show();
     });
     connect(pullbackDelegate, &KlineButtonDelegate::klineClicked, this, [this](const QModelIndex& index) {
         if (!index.isValid()) return;
-        const auto& rows = m_pullbackModel->rows();
-        if (index.row() < 0 || index.row() >= rows.size()) return;
-        const auto& row = rows[index.row()];
+        if (index.row() < 0 || index.row() >= m_pullbackModel->rowCount()) return;
+        const auto& row = m_pullbackModel->rowAt(index.row());
         auto* dialog = new KlineDialog(row.code, row.market, row.name, this);
         dialog->setAttribute(Qt::WA_DeleteOnClose, true);
         dialog->show();
     });
 
     connect(ui->btnScan, &QPushButton::clicked, this, [this](){
-        ScanConfig cfg;
-        cfg.belowDays = ui->spinBelowDays->value();
-        cfg.includeBJ = ui->cbIncludeBJ->isChecked();
-        cfg.requireMa5SlopeUp = ui->cbMa5SlopeUp->isChecked();
-        const auto apiData = ui->comboApiProvider->currentData().toMap();
-        if (!apiData.isEmpty()) {
-            cfg.provider = static_cast<ScanConfig::Provider>(apiData.value("provider").toInt());
-            cfg.spotBaseUrl = apiData.value("spot").toString();
-            cfg.klineBaseUrl = apiData.value("kline").toString();
-        }
-//        cfg.excludeST = ui->cbExcludeST->isChecked();
-        cfg.pageSize = ui->spinPageSize->value();
-        cfg.maxInFlight = ui->spinInFlight->value();
-        cfg.timeoutMs = ui->spinTimeout->value();
-        cfg.maxRetries = ui->spinRetry->value();
-        cfg.sortField = ui->comboSortField->currentIndex();
-        cfg.sortDesc = ui->cbSortDesc->isChecked();
-        cfg.mode = ScanConfig::Mode::BreakAboveMa5;
-
+        const ScanConfig cfg = breakAboveConfigFromUi();
         m_activeMode = ScanConfig::Mode::BreakAboveMa5;
+        const QStringList visible = visibleCodes(m_activeMode);
         m_model->setRows({});
         updateStage("启动扫描...", m_activeMode);
         setUiBusy(true);
         m_scanner->runOnce(cfg);
+        m_scanner->prioritize(visible);
     });
 
     connect(ui->btnCancel, &QPushButton::clicked, this, [this](){
@@ -126,37 +122,74 @@ MainWindow::MainWindow(QWidget *parent)
     });
 
     connect(ui->btnPullbackScan, &QPushButton::clicked, this, [this](){
-        ScanConfig cfg;
-        cfg.belowDays = ui->spinBelowDays->value();
-        cfg.pullbackAboveDays = ui->spinPullbackAboveDays->value();
-        cfg.pullbackTolerancePct = ui->spinPullbackTolerance->value();
-        cfg.includeBJ = ui->cbPullbackIncludeBJ->isChecked();
-        cfg.requireMa5SlopeUp = ui->cbPullbackSlopeUp->isChecked();
-        const auto apiData = ui->comboPullbackApiProvider->currentData().toMap();
-        if (!apiData.isEmpty()) {
-            cfg.provider = static_cast<ScanConfig::Provider>(apiData.value("provider").toInt());
-            cfg.spotBaseUrl = apiData.value("spot").toString();
-            cfg.klineBaseUrl = apiData.value("kline").toString();
-        }
-        cfg.pageSize = ui->spinPullbackPageSize->value();
-        cfg.maxInFlight = ui->spinPullbackInFlight->value();
-        cfg.timeoutMs = ui->spinPullbackTimeout->value();
-        cfg.maxRetries = ui->spinPullbackRetry->value();
-        cfg.sortField = ui->comboPullbackSortField->currentIndex();
-        cfg.sortDesc = ui->cbPullbackSortDesc->isChecked();
-        cfg.mode = ScanConfig::Mode::PullbackToMa5;
-
+        const ScanConfig cfg = pullbackConfigFromUi();
         m_activeMode = ScanConfig::Mode::PullbackToMa5;
+        const QStringList visible = visibleCodes(m_activeMode);
         m_pullbackModel->setRows({});
         updateStage("启动扫描...", m_activeMode);
         setUiBusy(true);
         m_scanner->runOnce(cfg);
+        m_scanner->prioritize(visible);
     });
 
     connect(ui->btnPullbackCancel, &QPushButton::clicked, this, [this](){
         m_scanner->cancel();
     });
 
+    // 断点续扫：只拉上次没完成的股票；断点按K线源区分，换源后重新判断按钮状态
+    connect(ui->btnResume, &QPushButton::clicked, this, [this](){
+        resumeScan(ScanConfig::Mode::BreakAboveMa5);
+    });
+    connect(ui->btnPullbackResume, &QPushButton::clicked, this, [this](){
+        resumeScan(ScanConfig::Mode::PullbackToMa5);
+    });
+    connect(ui->comboApiProvider, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](){
+        if (ui->btnScan->isEnabled()) updateResumeButtons();
+    });
+
+    // 参数变化：用上次扫描保留的 streak 状态在内存里重判，表格实时更新
+    const auto refilterBreak = [this](){ refilter(ScanConfig::Mode::BreakAboveMa5); };
+    const auto refilterPullback = [this](){ refilter(ScanConfig::Mode::PullbackToMa5); };
+    connect(ui->spinBelowDays, QOverload<int>::of(&QSpinBox::valueChanged), this, refilterBreak);
+    connect(ui->cbMa5SlopeUp, &QCheckBox::toggled, this, refilterBreak);
+    connect(ui->spinTopK, QOverload<int>::of(&QSpinBox::valueChanged), this, refilterBreak);
+    connect(ui->spinPullbackAboveDays, QOverload<int>::of(&QSpinBox::valueChanged), this, refilterPullback);
+    connect(ui->spinPullbackTolerance, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, refilterPullback);
+    connect(ui->cbPullbackSlopeUp, &QCheckBox::toggled, this, refilterPullback);
+    connect(ui->spinPullbackTopK, QOverload<int>::of(&QSpinBox::valueChanged), this, refilterPullback);
+
+    // 盯盘：完整扫描之后只按间隔刷新行情，用保留的收盘状态重判
+    connect(ui->cbWatch, &QCheckBox::toggled, this, [this](bool on){
+        setWatching(ScanConfig::Mode::BreakAboveMa5, on);
+    });
+    connect(ui->cbPullbackWatch, &QCheckBox::toggled, this, [this](bool on){
+        setWatching(ScanConfig::Mode::PullbackToMa5, on);
+    });
+    connect(ui->spinWatchInterval, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](){
+        if (m_scanner->isWatching(ScanConfig::Mode::BreakAboveMa5)) setWatching(ScanConfig::Mode::BreakAboveMa5, true);
+    });
+    connect(ui->spinPullbackWatchInterval, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](){
+        if (m_scanner->isWatching(ScanConfig::Mode::PullbackToMa5)) setWatching(ScanConfig::Mode::PullbackToMa5, true);
+    });
+
+    // 结果过滤：代码/名称子串 + 板块
+    connect(ui->editFilter, &QLineEdit::textChanged, m_model, &QuoteModel::setFilterText);
+    connect(ui->editPullbackFilter, &QLineEdit::textChanged, m_pullbackModel, &QuoteModel::setFilterText);
+    connect(ui->comboSector, &QComboBox::currentTextChanged, this, [this](const QString& text){
+        m_model->setSectorFilter(ui->comboSector->currentIndex() > 0 ? text : QString());
+    });
+    connect(ui->comboPullbackSector, &QComboBox::currentTextChanged, this, [this](const QString& text){
+        m_pullbackModel->setSectorFilter(ui->comboPullbackSector->currentIndex() > 0 ? text : QString());
+    });
+    connect(m_model, &QuoteModel::sectorsChanged, this, [this](){
+        fillSectorCombo(ui->comboSector, m_model);
+    });
+    connect(m_pullbackModel, &QuoteModel::sectorsChanged, this, [this](){
+        fillSectorCombo(ui->comboPullbackSector, m_pullbackModel);
+    });
+    fillSectorCombo(ui->comboSector, m_model);
+    fillSectorCombo(ui->comboPullbackSector, m_pullbackModel);
+
     connect(ui->btnTest, &QPushButton::clicked, this, [this](){
         updateStage("测试接口中...", ScanConfig::Mode::BreakAboveMa5);
 //        m_scanner->testApis(ui->editTestCode->text());
@@ -179,6 +212,16 @@ MainWindow::MainWindow(QWidget *parent)
         updateProgress(done, total, m_activeMode);
     });
 
+    connect(m_scanner, &Ma5Scanner::rowsFound, this, [this](QVector<PickRow> rows){
+        QuoteModel* model = (m_activeMode == ScanConfig::Mode::BreakAboveMa5) ? m_model : m_pullbackModel;
+        model->appendRows(rows);
+    });
+
+    connect(m_scanner, &Ma5Scanner::rowsEvicted, this, [this](QStringList codes){
+        QuoteModel* model = (m_activeMode == ScanConfig::Mode::BreakAboveMa5) ? m_model : m_pullbackModel;
+        model->removeCodes(codes);
+    });
+
     connect(m_scanner, &Ma5Scanner::finished, this, [this](QVector<PickRow> rows){
         if (m_activeMode == ScanConfig::Mode::BreakAboveMa5) {
             m_model->setRows(rows);
@@ -193,11 +236,56 @@ MainWindow::MainWindow(QWidget *parent)
         QMessageBox::warning(this, "扫描失败", e);
     });
 
+    // 每轮扫描的性能摘要挂在状态文字的提示上；完整记录和时间线在 AppData/metrics/
+    connect(m_scanner, &Ma5Scanner::metricsReady, this, [this](const QJsonObject& summary){
+        QLabel* label = (m_activeMode == ScanConfig::Mode::BreakAboveMa5) ? ui->labelStage : ui->labelPullbackStage;
+        label->setToolTip(ScanMetrics::describe(summary) + "\n" + ScanMetrics::directory());
+    });
+
     connect(m_scanner, &Ma5Scanner::cancelled, this, [this](){
         setUiBusy(false);
         updateStage("已取消", m_activeMode);
     });
 
+    connect(m_scanner, &Ma5Scanner::watchUpdated, this,
+            [this](ScanConfig::Mode mode, QVector<PickRow> rows, QStringList entered, QStringList exited){
+        QuoteModel* model = (mode == ScanConfig::Mode::BreakAboveMa5) ? m_model : m_pullbackModel;
+        model->setRows(rows);
+        QString text = QString("盯盘 %1：%2 只满足条件")
+                           .arg(QTime::currentTime().toString("HH:mm:ss"))
+                           .arg(rows.size());
+        if (!entered.isEmpty()) text += QString("，新进 %1（%2）").arg(entered.size()).arg(entered.mid(0, 5).join(" "));
+        if (!exited.isEmpty()) text += QString("，退出 %1（%2）").arg(exited.size()).arg(exited.mid(0, 5).join(" "));
+        updateStage(text, mode);
+
+        const bool alert = (mode == ScanConfig::Mode::BreakAboveMa5) ? ui->cbWatchAlert->isChecked()
+                                                                     : ui->cbPullbackWatchAlert->isChecked();
+        if (alert && !entered.isEmpty()) notifyEntered(mode, rows, entered);
+    });
+
+    connect(m_scanner, &Ma5Scanner::watchStopped, this, [this](const QString& reason){
+        for (QCheckBox* cb : {ui->cbWatch, ui->cbPullbackWatch}) {
+            if (!cb->isChecked()) continue;
+            QSignalBlocker blocker(cb);
+            cb->setChecked(false);
+        }
+        updateStage(reason, ScanConfig::Mode::BreakAboveMa5);
+        updateStage(reason, ScanConfig::Mode::PullbackToMa5);
+    });
+
+    // 状态栏常驻内存占用；顺带按软上限裁剪缓存，空闲时也能在换页前让出内存
+    m_memoryLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_memoryLabel);
+    auto* memoryTimer = new QTimer(this);
+    connect(memoryTimer, &QTimer::timeout, this, &MainWindow::updateMemoryStatus);
+    memoryTimer->start(2000);
+    updateMemoryStatus();
+
+    // 习惯用 TradingView 的，启动后空闲时先把页面和 tv.js 加载好
+    if (KlineDialog::prefersTradingView()) {
+        QTimer::singleShot(1500, this, [](){ TradingViewPool::instance().warmUp(); });
+    }
+
 //    connect(m_scanner, &Ma5Scanner::testFinished, this, [this](const QString& rep){
 //        ui->labelStage->setText("测试完成");
 //        QMessageBox::information(this, "接口测试结果", rep);
@@ -213,6 +301,130 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+ScanConfig MainWindow::breakAboveConfigFromUi() const
+{
+    ScanConfig cfg;
+    cfg.belowDays = ui->spinBelowDays->value();
+    cfg.includeBJ = ui->cbIncludeBJ->isChecked();
+    cfg.requireMa5SlopeUp = ui->cbMa5SlopeUp->isChecked();
+    const auto apiData = ui->comboApiProvider->currentData().toMap();
+    if (!apiData.isEmpty()) {
+        cfg.provider = static_cast<ScanConfig::Provider>(apiData.value("provider").toInt());
+        cfg.spotBaseUrl = apiData.value("spot").toString();
+        cfg.klineBaseUrl = apiData.value("kline").toString();
+    }
+//    cfg.excludeST = ui->cbExcludeST->isChecked();
+    cfg.pageSize = ui->spinPageSize->value();
+    cfg.maxInFlight = ui->spinInFlight->value();
+    cfg.timeoutMs = ui->spinTimeout->value();
+    cfg.maxRetries = ui->spinRetry->value();
+    cfg.sortField = ui->comboSortField->currentIndex();
+    cfg.sortDesc = ui->cbSortDesc->isChecked();
+    cfg.topK = ui->spinTopK->value();
+    cfg.mode = ScanConfig::Mode::BreakAboveMa5;
+    return cfg;
+}
+
+ScanConfig MainWindow::pullbackConfigFromUi() const
+{
+    ScanConfig cfg;
+    cfg.belowDays = ui->spinBelowDays->value();
+    cfg.pullbackAboveDays = ui->spinPullbackAboveDays->value();
+    cfg.pullbackTolerancePct = ui->spinPullbackTolerance->value();
+    cfg.includeBJ = ui->cbPullbackIncludeBJ->isChecked();
+    cfg.requireMa5SlopeUp = ui->cbPullbackSlopeUp->isChecked();
+    const auto apiData = ui->comboPullbackApiProvider->currentData().toMap();
+    if (!apiData.isEmpty()) {
+        cfg.provider = static_cast<ScanConfig::Provider>(apiData.value("provider").toInt());
+        cfg.spotBaseUrl = apiData.value("spot").toString();
+        cfg.klineBaseUrl = apiData.value("kline").toString();
+    }
+    cfg.pageSize = ui->spinPullbackPageSize->value();
+    cfg.maxInFlight = ui->spinPullbackInFlight->value();
+    cfg.timeoutMs = ui->spinPullbackTimeout->value();
+    cfg.maxRetries = ui->spinPullbackRetry->value();
+    cfg.sortField = ui->comboPullbackSortField->currentIndex();
+    cfg.sortDesc = ui->cbPullbackSortDesc->isChecked();
+    cfg.topK = ui->spinPullbackTopK->value();
+    cfg.mode = ScanConfig::Mode::PullbackToMa5;
+    return cfg;
+}
+
+void MainWindow::refilter(ScanConfig::Mode mode)
+{
+    // 扫描进行中 / 尚无完整状态：等下次扫描
+    if (!m_scanner->hasStates()) return;
+
+    const bool isBreak = (mode == ScanConfig::Mode::BreakAboveMa5);
+    const ScanConfig cfg = isBreak ? breakAboveConfigFromUi() : pullbackConfigFromUi();
+    if (!m_scanner->statesCover(cfg)) {
+        updateStage("上次扫描按缓存跳过了当时参数下不可能命中的股票，放宽条件或换模式需重新扫描", mode);
+        return;
+    }
+    const QVector<PickRow> rows = m_scanner->reevaluate(cfg);
+    QuoteModel* model = isBreak ? m_model : m_pullbackModel;
+    model->setRows(rows);
+    updateStage(QString("参数已更新：%1 只满足条件").arg(rows.size()), mode);
+    setUiBusy(false);
+
+    // 盯盘中改参数：新结果作为下一次刷新的进出基准
+    if (m_scanner->isWatching(mode)) {
+        const int seconds = isBreak ? ui->spinWatchInterval->value() : ui->spinPullbackWatchInterval->value();
+        m_scanner->watch(cfg, seconds * 1000);
+    }
+}
+
+void MainWindow::setWatching(ScanConfig::Mode mode, bool on)
+{
+    const bool isBreak = (mode == ScanConfig::Mode::BreakAboveMa5);
+    if (!on) {
+        m_scanner->unwatch(mode);
+        updateStage("盯盘已停止", mode);
+        return;
+    }
+
+    // 先按当前参数刷新表格，盯盘以它为进出基准
+    const ScanConfig cfg = isBreak ? breakAboveConfigFromUi() : pullbackConfigFromUi();
+    const int seconds = isBreak ? ui->spinWatchInterval->value() : ui->spinPullbackWatchInterval->value();
+    if (m_scanner->statesCover(cfg)) {
+        QuoteModel* model = isBreak ? m_model : m_pullbackModel;
+        model->setRows(m_scanner->reevaluate(cfg));
+    }
+    if (!m_scanner->watch(cfg, seconds * 1000)) {
+        QCheckBox* cb = isBreak ? ui->cbWatch : ui->cbPullbackWatch;
+        QSignalBlocker blocker(cb);
+        cb->setChecked(false);
+        QMessageBox::information(this, "盯盘", "请先按当前模式和条件完成一次当天的完整扫描，再开启盯盘");
+        return;
+    }
+    updateStage(seconds > 0 ? QString("盯盘中：每 %1 秒刷新行情").arg(seconds)
+                            : QString("盯盘中：实时推送"), mode);
+}
+
+void MainWindow::notifyEntered(ScanConfig::Mode mode, const QVector<PickRow>& rows, const QStringList& codes)
+{
+    QHash<QString, QString> names;
+    for (const auto& r : rows) names.insert(r.code, r.name);
+    QStringList items;
+    for (const auto& code : codes.mid(0, 8)) {
+        const QString name = names.value(code);
+        items << (name.isEmpty() ? code : QString("%1 %2").arg(code, name));
+    }
+    if (codes.size() > items.size()) items << QString("等 %1 只").arg(codes.size());
+
+    const QString title = (mode == ScanConfig::Mode::BreakAboveMa5) ? "突破MA5 新进" : "回踩MA5 新进";
+    if (!m_tray && QSystemTrayIcon::isSystemTrayAvailable()) {
+        m_tray = new QSystemTrayIcon(windowIcon(), this);
+        m_tray->setToolTip("Pickwise 盯盘");
+        m_tray->show();
+    }
+    if (m_tray && QSystemTrayIcon::supportsMessages()) {
+        m_tray->showMessage(title, items.join("，"), QSystemTrayIcon::Information, 8000);
+    } else {
+        QApplication::beep();
+    }
+}
+
 void MainWindow::exportCsv(const QuoteModel* model)
 {
     if (!model || model->rowCount() == 0) {
@@ -229,7 +441,7 @@ void MainWindow::exportCsv(const QuoteModel* model)
     }
     QTextStream ts(&f);
     ts << "code,name,sector,pe,market,last,ma5,biasPct,belowDays\n";
-    for (const auto& r : model->rows()) {
+    for (const auto& r : model->visibleRows()) {
         ts << r.code << "," << r.name << "," << r.sector << "," << r.pe << ","
            << r.market << "," << r.last << "," << r.ma5 << "," << r.biasPct << "," << r.belowDays << "\n";
     }
@@ -237,6 +449,99 @@ void MainWindow::exportCsv(const QuoteModel* model)
     QMessageBox::information(this, "导出", "导出完成");
 }
 
+void MainWindow::fillSectorCombo(QComboBox* combo, const QuoteModel* model)
+{
+    const QString current = combo->currentIndex() > 0 ? combo->currentText() : QString();
+    QStringList names = model->sectors();
+    // 重新扫描时保留已选板块，新结果出现后自动命中
+    if (!current.isEmpty() && !names.contains(current)) names.push_back(current);
+    names.sort();
+
+    QSignalBlocker blocker(combo);
+    combo->clear();
+    combo->addItem("全部板块");
+    combo->addItems(names);
+    const int idx = current.isEmpty() ? 0 : combo->findText(current);
+    combo->setCurrentIndex(idx > 0 ? idx : 0);
+}
+
+void MainWindow::resumeScan(ScanConfig::Mode mode)
+{
+    const bool pullback = (mode == ScanConfig::Mode::PullbackToMa5);
+    const ScanConfig cfg = pullback ? pullbackConfigFromUi() : breakAboveConfigFromUi();
+    m_activeMode = mode;
+    const QStringList visible = visibleCodes(mode);
+    (pullback ? m_pullbackModel : m_model)->setRows({});
+    updateStage("从断点续扫...", mode);
+    setUiBusy(true);
+    if (!m_scanner->resume(cfg)) {
+        setUiBusy(false);
+        updateStage("没有可用的断点（只在当天、同一数据源内有效）", mode);
+        return;
+    }
+    m_scanner->prioritize(visible);
+}
+
+// 表格里当前滚动可见的行（开扫前即上一轮的结果），重扫时先拉它们
+QStringList MainWindow::visibleCodes(ScanConfig::Mode mode) const
+{
+    const bool pullback = (mode == ScanConfig::Mode::PullbackToMa5);
+    const QTableView* view = pullback ? ui->tableViewPullback : ui->tableView;
+    const QuoteModel* model = pullback ? m_pullbackModel : m_model;
+    QStringList codes;
+    if (model->rowCount() == 0) return codes;
+    const int first = qMax(0, view->rowAt(0));
+    int last = view->rowAt(view->viewport()->height() - 1);
+    if (last < 0) last = model->rowCount() - 1;
+    for (int row = first; row <= last; ++row) codes << model->rowAt(row).code;
+    return codes;
+}
+
+void MainWindow::updateResumeButtons()
+{
+    const struct {
+        QPushButton* button;
+        ScanConfig cfg;
+    } items[] = {
+        {ui->btnResume, breakAboveConfigFromUi()},
+        {ui->btnPullbackResume, pullbackConfigFromUi()},
+    };
+    for (const auto& item : items) {
+        int done = 0;
+        int total = 0;
+        const bool ok = Ma5Scanner::checkpointInfo(item.cfg, &done, &total);
+        item.button->setEnabled(ok);
+        item.button->setToolTip(ok ? QString("上次扫到 %1 / %2 只，续扫只拉剩下的").arg(done).arg(total)
+                                   : QString("没有当天的断点"));
+    }
+}
+
+void MainWindow::updateMemoryStatus()
+{
+    const bool pressure = MemoryUsage::enforce();
+    const QJsonObject mem = m_scanner->memoryReport();
+    auto fmt = [&mem](const char* key) {
+        return MemoryUsage::formatBytes(qint64(mem.value(QLatin1String(key)).toDouble()));
+    };
+
+    QString text = QString("内存 %1 · K线缓存 %2 · K线仓库 %3").arg(fmt("rss"), fmt("klineCache"), fmt("barStore"));
+    if (pressure) text += "（超出进程上限，缓存已减半）";
+    m_memoryLabel->setText(text);
+
+    const MemoryUsage::Limits limits = MemoryUsage::limits();
+    auto limitText = [](qint64 bytes) { return bytes > 0 ? MemoryUsage::formatBytes(bytes) : QString("不限"); };
+    QStringList lines;
+    lines << QString("常驻 %1，峰值 %2").arg(fmt("rss"), fmt("peakRss"))
+          << QString("K线缓存 %1（%2 条，上限 %3）")
+                 .arg(fmt("klineCache")).arg(mem.value("klineCacheEntries").toInt()).arg(limitText(limits.klineCacheBytes))
+          << QString("K线仓库 %1（上限 %2）").arg(fmt("barStore"), limitText(limits.barStoreBytes))
+          << QString("推演缓存 %1（上限 %2）").arg(fmt("backtestCache"), limitText(limits.backtestCacheBytes))
+          << QString("列表 %1 · 队列 %2 · 在途任务 %3").arg(fmt("spots"), fmt("queue"), fmt("tasks"))
+          << QString("结果 %1 · 派生状态 %2").arg(fmt("results"), fmt("states"))
+          << QString("上限在 settings.ini 的 [memory] 节设置（MB，0 = 不限）");
+    m_memoryLabel->setToolTip(lines.join("\n"));
+}
+
 void MainWindow::updateProgress(int done, int total, ScanConfig::Mode mode)
 {
     QProgressBar* bar = (mode == ScanConfig::Mode::BreakAboveMa5) ? ui->progressBar : ui->progressBarPullback;
@@ -264,4 +569,12 @@ void MainWindow::setUiBusy(bool busy)
     ui->btnPullbackScan->setEnabled(!busy);
     ui->btnPullbackCancel->setEnabled(busy);
     ui->btnPullbackExport->setEnabled(!busy && m_pullbackModel->rowCount() > 0);
+    ui->cbWatch->setEnabled(!busy);
+    ui->cbPullbackWatch->setEnabled(!busy);
+    if (busy) {
+        ui->btnResume->setEnabled(false);
+        ui->btnPullbackResume->setEnabled(false);
+    } else {
+        updateResumeButtons();
+    }
 }
@@ -5,6 +5,9 @@
 #include "QuoteModel.h"
 
 class BacktestWidget;
+class QComboBox;
+class QLabel;
+class QSystemTrayIcon;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -20,8 +23,18 @@ public:
 private:
     void setUiBusy(bool busy);
     void exportCsv(const QuoteModel* model);
+    void fillSectorCombo(QComboBox* combo, const QuoteModel* model);
     void updateProgress(int done, int total, ScanConfig::Mode mode);
     void updateStage(const QString& text, ScanConfig::Mode mode);
+    ScanConfig breakAboveConfigFromUi() const;
+    ScanConfig pullbackConfigFromUi() const;
+    void refilter(ScanConfig::Mode mode);
+    void setWatching(ScanConfig::Mode mode, bool on);
+    void notifyEntered(ScanConfig::Mode mode, const QVector<PickRow>& rows, const QStringList& codes);
+    void updateMemoryStatus();
+    void updateResumeButtons();
+    void resumeScan(ScanConfig::Mode mode);
+    QStringList visibleCodes(ScanConfig::Mode mode) const;
 
 private:
     Ui::MainWindow *ui;
@@ -29,5 +42,7 @@ private:
     QuoteModel* m_model = nullptr;
     QuoteModel* m_pullbackModel = nullptr;
     BacktestWidget* m_backtestWidget = nullptr;
+    QSystemTrayIcon* m_tray = nullptr;
+    QLabel* m_memoryLabel = nullptr;
     ScanConfig::Mode m_activeMode = ScanConfig::Mode::BreakAboveMa5;
 };
@@ -0,0 +1,18 @@
+# 本地行情替身：按东财 push2 / push2his 的接口形状出合成数据（列表、SSE 推送、日K线），离线调试用
+QT       = core network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = pickwise-quotefeed
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    main.cpp
+
+msvc
+{
+    QMAKE_CFLAGS += /utf-8
+    QMAKE_CXXFLAGS += /utf-8
+}
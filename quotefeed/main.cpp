@@ -0,0 +1,306 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDate>
+#include <QHostAddress>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <algorithm>
+#include <cmath>
+
+// 本地行情替身：接口形状与东财一致，数据是按种子生成的合成行情
+//   GET /api/qt/clist/get?pn=&pz=           列表分页（按代码排序）
+//   GET /api/qt/clist/sse                   SSE：首帧全量数组，之后每 tick 推一批变化行（以行位置为键）
+//   GET /api/qt/stock/kline/get?secid=&lmt= 日K线，截至昨天
+// 扫描配置里把 spotBaseUrl / klineBaseUrl 指到这里即可离线跑完整扫描和盯盘；
+// 桌面程序设置环境变量 PICKWISE_QUOTEFEED=http://127.0.0.1:<port> 后会多出一个数据源
+namespace {
+const int kMaxHeaderBytes = 16 * 1024;
+const int kBars = 160;
+const int kHeartbeatMs = 15000;
+
+struct Row {
+    QString code;
+    QString name;
+    QString sector;
+    int market = 0;
+    double pe = 0;
+    double last = 0;
+    QVector<QDate> dates;
+    QVector<double> closes;     // 截至昨天的收盘价
+};
+
+class QuoteFeed : public QObject
+{
+public:
+    QuoteFeed(int symbols, int tickMs, int changesPerTick, quint32 seed)
+        : m_rng(seed), m_changesPerTick(changesPerTick)
+    {
+        generate(symbols, seed);
+
+        m_server = new QTcpServer(this);
+        connect(m_server, &QTcpServer::newConnection, this, [this]() {
+            while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+                m_buffers.insert(socket, QByteArray());
+                connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+                connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                    m_buffers.remove(socket);
+                    m_streams.removeAll(socket);
+                    socket->deleteLater();
+                });
+            }
+        });
+
+        auto* tick = new QTimer(this);
+        connect(tick, &QTimer::timeout, this, &QuoteFeed::tick);
+        tick->start(tickMs);
+
+        auto* heartbeat = new QTimer(this);
+        connect(heartbeat, &QTimer::timeout, this, [this]() { broadcast(": ping\n\n"); });
+        heartbeat->start(kHeartbeatMs);
+    }
+
+    bool listen(quint16 port, QString* error)
+    {
+        if (m_server->listen(QHostAddress::LocalHost, port)) return true;
+        if (error) *error = m_server->errorString();
+        return false;
+    }
+
+private:
+    void generate(int symbols, quint32 seed)
+    {
+        static const char* sectors[] = {"银行", "电子", "医药生物", "计算机", "机械设备", "有色金属", "汽车", "食品饮料"};
+        // 交易日：往前数工作日，不含今天
+        QVector<QDate> dates;
+        for (QDate d = QDate::currentDate().addDays(-1); dates.size() < kBars; d = d.addDays(-1)) {
+            if (d.dayOfWeek() <= 5) dates.prepend(d);
+        }
+
+        for (int i = 0; i < symbols; ++i) {
+            Row r;
+            // 一半沪市 6xxxxx，一半深市 00xxxx
+            const bool sh = (i % 2 == 0);
+            r.code = sh ? QString::number(600000 + i / 2) : QString("%1").arg(1 + i / 2, 6, 10, QChar('0'));
+            r.market = sh ? 1 : 0;
+            r.name = QString("合成%1").arg(r.code.right(4));
+            r.sector = QString::fromUtf8(sectors[i % 8]);
+            r.dates = dates;
+
+            QRandomGenerator gen(seed ^ quint32(qHash(r.code)));
+            double price = 5.0 + gen.bounded(60.0);
+            r.closes.reserve(kBars);
+            for (int b = 0; b < kBars; ++b) {
+                price = std::max(1.0, price * (1.0 + (gen.generateDouble() - 0.5) * 0.06));
+                r.closes.push_back(std::round(price * 100.0) / 100.0);
+            }
+            r.last = r.closes.back();
+            r.pe = 5.0 + gen.bounded(80.0);
+            m_rows.push_back(r);
+        }
+        std::sort(m_rows.begin(), m_rows.end(), [](const Row& a, const Row& b) { return a.code < b.code; });
+        for (int i = 0; i < m_rows.size(); ++i) m_index.insert(m_rows[i].code, i);
+    }
+
+    static QJsonObject rowJson(const Row& r)
+    {
+        return QJsonObject{
+            {"f12", r.code}, {"f14", r.name}, {"f2", r.last},
+            {"f13", r.market}, {"f9", r.pe}, {"f100", r.sector},
+        };
+    }
+
+    void tick()
+    {
+        if (m_rows.isEmpty() || m_streams.isEmpty()) return;
+
+        // 随机挑几行做价格随机游走，围绕昨收 ±5% 左右，足够让一些股票穿越 MA5
+        QJsonObject diff;
+        for (int k = 0; k < m_changesPerTick; ++k) {
+            const int pos = int(m_rng.bounded(quint32(m_rows.size())));
+            Row& r = m_rows[pos];
+            const double prev = r.closes.back();
+            double next = r.last * (1.0 + (m_rng.generateDouble() - 0.5) * 0.01);
+            next = std::clamp(next, prev * 0.9, prev * 1.1);
+            r.last = std::round(next * 100.0) / 100.0;
+            diff.insert(QString::number(pos), QJsonObject{{"f2", r.last}});
+        }
+        const QJsonObject msg{{"rc", 0}, {"data", QJsonObject{{"diff", diff}}}};
+        broadcast("data: " + QJsonDocument(msg).toJson(QJsonDocument::Compact) + "\n\n");
+    }
+
+    void broadcast(const QByteArray& bytes)
+    {
+        for (auto* socket : m_streams) socket->write(bytes);
+    }
+
+    void onReadyRead(QTcpSocket* socket)
+    {
+        auto it = m_buffers.find(socket);
+        if (it == m_buffers.end()) return;
+        it->append(socket->readAll());
+        const int headerEnd = it->indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            if (it->size() > kMaxHeaderBytes) {
+                m_buffers.erase(it);
+                respond(socket, 400, QJsonObject{{"error", "请求头过大"}});
+            }
+            return;
+        }
+        const QByteArray requestLine = it->left(it->indexOf("\r\n"));
+        m_buffers.erase(it);
+        const QList<QByteArray> parts = requestLine.split(' ');
+        if (parts.size() < 2 || parts[0] != "GET") {
+            respond(socket, 405, QJsonObject{{"error", "只支持 GET"}});
+            return;
+        }
+
+        const QUrl url(QString::fromUtf8(parts[1]));
+        const QUrlQuery query(url);
+        const QString path = url.path();
+        if (path.endsWith("/clist/sse")) {
+            openStream(socket);
+        } else if (path.endsWith("/clist/get")) {
+            servePage(socket, query.queryItemValue("pn").toInt(), query.queryItemValue("pz").toInt());
+        } else if (path.endsWith("/kline/get")) {
+            serveKline(socket, query);
+        } else {
+            respond(socket, 404, QJsonObject{{"error", "未知路径"}});
+        }
+    }
+
+    void openStream(QTcpSocket* socket)
+    {
+        // 不带 Content-Length：正文一直到连接关闭
+        socket->write("HTTP/1.1 200 OK\r\n"
+                      "Content-Type: text/event-stream; charset=utf-8\r\n"
+                      "Cache-Control: no-cache\r\n"
+                      "Connection: keep-alive\r\n\r\n"
+                      "retry: 2000\n\n");
+        QJsonArray all;
+        for (const auto& r : m_rows) all.push_back(rowJson(r));
+        const QJsonObject msg{{"rc", 0}, {"data", QJsonObject{{"total", int(m_rows.size())}, {"diff", all}}}};
+        socket->write("data: " + QJsonDocument(msg).toJson(QJsonDocument::Compact) + "\n\n");
+        m_streams.push_back(socket);
+    }
+
+    void servePage(QTcpSocket* socket, int pn, int pz)
+    {
+        pn = std::max(1, pn);
+        pz = std::clamp(pz, 1, 10000);
+        const int from = (pn - 1) * pz;
+        QJsonObject data{{"total", int(m_rows.size())}};
+        if (from < m_rows.size()) {
+            QJsonArray diff;
+            for (int i = from; i < std::min<int>(m_rows.size(), from + pz); ++i) diff.push_back(rowJson(m_rows[i]));
+            data.insert("diff", diff);
+        } else {
+            data.insert("diff", QJsonValue());
+        }
+        respond(socket, 200, QJsonObject{{"rc", 0}, {"data", data}});
+    }
+
+    void serveKline(QTcpSocket* socket, const QUrlQuery& query)
+    {
+        const QString secid = query.queryItemValue("secid");
+        const QString code = secid.section('.', 1);
+        const auto it = m_index.find(code);
+        // 市场号对不上时与东财一致：data 为 null，调用方会换市场重试
+        if (it == m_index.end() || secid.section('.', 0, 0).toInt() != m_rows[*it].market) {
+            respond(socket, 200, QJsonObject{{"rc", 0}, {"data", QJsonValue()}});
+            return;
+        }
+        const Row& r = m_rows[*it];
+
+        const QDate beg = QDate::fromString(query.queryItemValue("beg"), "yyyyMMdd");
+        const QDate end = QDate::fromString(query.queryItemValue("end"), "yyyyMMdd");
+        int lmt = query.queryItemValue("lmt").toInt();
+        if (lmt <= 0) lmt = r.closes.size();
+
+        QJsonArray klines;
+        for (int i = 0; i < r.closes.size(); ++i) {
+            if (beg.isValid() && r.dates[i] < beg) continue;
+            if (end.isValid() && r.dates[i] > end) continue;
+            const double close = r.closes[i];
+            const double open = i > 0 ? r.closes[i - 1] : close;
+            const double high = std::max(open, close) * 1.01;
+            const double low = std::min(open, close) * 0.99;
+            klines.push_back(QString("%1,%2,%3,%4,%5,%6")
+                                 .arg(r.dates[i].toString("yyyy-MM-dd"))
+                                 .arg(open, 0, 'f', 2).arg(close, 0, 'f', 2)
+                                 .arg(high, 0, 'f', 2).arg(low, 0, 'f', 2)
+                                 .arg(100000 + (i * 7919) % 900000));
+        }
+        while (klines.size() > lmt) klines.removeFirst();
+        respond(socket, 200, QJsonObject{{"rc", 0}, {"data", QJsonObject{
+            {"code", r.code}, {"market", r.market}, {"name", r.name}, {"klines", klines}}}});
+    }
+
+    static void respond(QTcpSocket* socket, int status, const QJsonObject& body)
+    {
+        const QByteArray payload = QJsonDocument(body).toJson(QJsonDocument::Compact);
+        const QByteArray reason = status == 200 ? "OK" : status == 404 ? "Not Found"
+                                : status == 405 ? "Method Not Allowed" : "Bad Request";
+        socket->write("HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n"
+                      "Content-Type: application/json; charset=utf-8\r\n"
+                      "Content-Length: " + QByteArray::number(payload.size()) + "\r\n"
+                      "Connection: close\r\n\r\n" + payload);
+        socket->disconnectFromHost();
+    }
+
+    QTcpServer* m_server = nullptr;
+    QRandomGenerator m_rng;
+    int m_changesPerTick = 0;
+    QVector<Row> m_rows;
+    QHash<QString, int> m_index;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QList<QTcpSocket*> m_streams;
+};
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pickwise 本地行情替身：东财接口形状的合成列表、SSE 推送和日K线");
+    parser.addHelpOption();
+    const QCommandLineOption portOpt("port", "监听端口（仅 127.0.0.1）。", "port", "8770");
+    const QCommandLineOption symbolsOpt("symbols", "合成股票数。", "n", "500");
+    const QCommandLineOption tickOpt("tick", "SSE 推送间隔毫秒。", "ms", "500");
+    const QCommandLineOption changesOpt("changes", "每次推送变化的行数。", "n", "20");
+    const QCommandLineOption seedOpt("seed", "随机种子，相同种子得到相同的K线。", "n", "1");
+    parser.addOptions({portOpt, symbolsOpt, tickOpt, changesOpt, seedOpt});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const quint16 port = quint16(parser.value(portOpt).toUInt());
+    const int symbols = parser.value(symbolsOpt).toInt();
+    const int tickMs = parser.value(tickOpt).toInt();
+    const int changes = parser.value(changesOpt).toInt();
+    if (port == 0 || symbols <= 0 || symbols > 20000 || tickMs <= 0 || changes <= 0) {
+        err << "参数无效\n";
+        return 2;
+    }
+
+    QuoteFeed feed(symbols, tickMs, changes, parser.value(seedOpt).toUInt());
+    QString error;
+    if (!feed.listen(port, &error)) {
+        err << error << "\n";
+        return 1;
+    }
+    const QString base = QString("http://127.0.0.1:%1").arg(port);
+    err << "列表  " << base << "/api/qt/clist/get\n"
+        << "推送  " << base << "/api/qt/clist/sse\n"
+        << "K线   " << base << "/api/qt/stock/kline/get\n";
+    err.flush();
+    return app.exec();
+}
@@ -0,0 +1,28 @@
+# 本地结果服务：一条扫描管线通过 HTTP/JSON 与 WebSocket 供本机多个客户端使用
+QT       = core network websockets concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = pickwise-service
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core/core.pri)
+
+SOURCES += \
+    ../ResultsService.cpp \
+    main.cpp
+
+HEADERS += \
+    ../ResultsService.h
+
+msvc
+{
+    QMAKE_CFLAGS += /utf-8
+    QMAKE_CXXFLAGS += /utf-8
+}
+
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,79 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QTextStream>
+#include "ResultsService.h"
+#include "ScanJson.h"
+
+int main(int argc, char* argv[])
+{
+    QLoggingCategory::setFilterRules(
+        QStringLiteral("qt.network.monitor.warning=false\n"
+                       "qt.network.monitor.info=false\n"
+                       "qt.network.monitor.debug=false\n")
+    );
+
+    QCoreApplication app(argc, argv);
+    // 与 GUI / CLI 共用 AppData 下的缓存
+    QCoreApplication::setApplicationName("Pickwise");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pickwise 本地结果服务：定时扫描，HTTP/JSON + WebSocket 推送");
+    parser.addHelpOption();
+    const QCommandLineOption configOpt("config", "JSON 扫描配置，键名同 ScanConfig 字段。", "file");
+    const QCommandLineOption portOpt("port", "HTTP 端口。", "port", "8765");
+    const QCommandLineOption wsPortOpt("ws-port", "WebSocket 端口。", "port", "8766");
+    const QCommandLineOption intervalOpt("interval", "两轮扫描间隔秒数。", "sec", "300");
+    const QCommandLineOption modesOpt("modes", "逗号分隔：break,pullback。", "list", "break,pullback");
+    parser.addOptions({configOpt, portOpt, wsPortOpt, intervalOpt, modesOpt});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    ServiceConfig cfg;
+
+    if (parser.isSet(configOpt)) {
+        QFile f(parser.value(configOpt));
+        if (!f.open(QIODevice::ReadOnly)) {
+            err << "无法读取配置文件：" << f.fileName() << "\n";
+            return 2;
+        }
+        QString error;
+        if (!ScanJson::applyConfig(QJsonDocument::fromJson(f.readAll()).object(), cfg.scan, &error)) {
+            err << error << "\n";
+            return 2;
+        }
+    }
+    cfg.httpPort = quint16(parser.value(portOpt).toUInt());
+    cfg.wsPort = quint16(parser.value(wsPortOpt).toUInt());
+    cfg.intervalSec = parser.value(intervalOpt).toInt();
+    if (cfg.httpPort == 0 || cfg.wsPort == 0 || cfg.intervalSec <= 0) {
+        err << "端口或间隔无效\n";
+        return 2;
+    }
+    cfg.modes.clear();
+    for (const auto& m : parser.value(modesOpt).split(',', Qt::SkipEmptyParts)) {
+        ScanConfig::Mode mode;
+        if (!ScanJson::parseMode(m.trimmed(), &mode)) {
+            err << "未知模式：" << m << "\n";
+            return 2;
+        }
+        if (!cfg.modes.contains(mode)) cfg.modes << mode;
+    }
+    if (cfg.modes.isEmpty()) {
+        err << "至少需要一个模式\n";
+        return 2;
+    }
+
+    ResultsService service(cfg);
+    QString error;
+    if (!service.start(&error)) {
+        err << error << "\n";
+        return 1;
+    }
+    err << "HTTP  http://127.0.0.1:" << cfg.httpPort << "/api/status\n"
+        << "WS    ws://127.0.0.1:" << cfg.wsPort << "\n";
+    err.flush();
+    return app.exec();
+}